@@ -0,0 +1,104 @@
+/*
+ *   Copyright 2026 agent <agent@local>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Library General Public License as
+ *   published by the Free Software Foundation; either version 2, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details
+ *
+ *   You should have received a copy of the GNU Library General Public
+ *   License along with this program; if not, write to the
+ *   Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <QtTest>
+#include <QQmlComponent>
+#include <QQmlEngine>
+#include <QQuickImageProvider>
+#include <QQuickItem>
+#include <QQuickView>
+
+//always fails, from the event loop as a real asynchronous provider would
+class FailingResponse : public QQuickImageResponse
+{
+public:
+    FailingResponse()
+    {
+        QMetaObject::invokeMethod(this, "finished", Qt::QueuedConnection);
+    }
+
+    QQuickTextureFactory *textureFactory() const Q_DECL_OVERRIDE
+    {
+        return Q_NULLPTR;
+    }
+
+    QString errorString() const Q_DECL_OVERRIDE
+    {
+        return QStringLiteral("failing on purpose");
+    }
+};
+
+class FailingProvider : public QQuickAsyncImageProvider
+{
+public:
+    QQuickImageResponse *requestImageResponse(const QString &id, const QSize &requestedSize) Q_DECL_OVERRIDE
+    {
+        Q_UNUSED(id)
+        requests.append(requestedSize);
+        return new FailingResponse;
+    }
+
+    QVector<QSize> requests;
+};
+
+class DesktopIconTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void failingImageResponse();
+};
+
+void DesktopIconTest::failingImageResponse()
+{
+    QQuickView view;
+    //the engine takes ownership of the provider
+    FailingProvider *provider = new FailingProvider;
+    view.engine()->addImageProvider(QStringLiteral("failing"), provider);
+
+    QQmlComponent component(view.engine());
+    component.setData("import QtQuick 2.6\n"
+                      "import org.kde.kirigami 2.2 as Kirigami\n"
+                      "Kirigami.Icon { width: 64; height: 64; source: \"image://failing/icon\" }", QUrl());
+    QScopedPointer<QQuickItem> icon(qobject_cast<QQuickItem *>(component.create()));
+    QVERIFY2(icon, qPrintable(component.errorString()));
+    if (!icon->inherits("DesktopIcon")) {
+        QSKIP("The selected style doesn't use DesktopIcon");
+    }
+    icon->setParentItem(view.contentItem());
+
+    view.resize(200, 200);
+    view.show();
+    QVERIFY(QTest::qWaitForWindowExposed(&view));
+
+    QTRY_COMPARE(provider->requests.count(), 1);
+    //the failure must not be followed by a request for the same size
+    QTest::qWait(200);
+    QCOMPARE(provider->requests.count(), 1);
+
+    //a new size is worth another try, just one
+    icon->setSize(QSizeF(128, 128));
+    QTRY_COMPARE(provider->requests.count(), 2);
+    QTest::qWait(200);
+    QCOMPARE(provider->requests.count(), 2);
+}
+
+QTEST_MAIN(DesktopIconTest)
+
+#include "desktopicontest.moc"
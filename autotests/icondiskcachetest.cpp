@@ -0,0 +1,122 @@
+/*
+ *   Copyright 2017 Marco Martin <mart@kde.org>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Library General Public License as
+ *   published by the Free Software Foundation; either version 2, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Library General Public License for more details
+ *
+ *   You should have received a copy of the GNU Library General Public
+ *   License along with this program; if not, write to the
+ *   Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <QtTest>
+#include <QIcon>
+
+#include "icondiskcache.h"
+#include "iconrasterizer.h"
+
+class IconDiskCacheTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void cacheHit();
+    void themeModified();
+
+private:
+    //writes the index.theme of the test theme, listing @p directories
+    void writeTheme(const QStringList &directories);
+    static IconCacheKey key();
+
+    QTemporaryDir m_themes;
+};
+
+void IconDiskCacheTest::initTestCase()
+{
+    qputenv("KIRIGAMI_ICON_DISK_CACHE", "1");
+    QStandardPaths::setTestModeEnabled(true);
+    QDir(QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + QStringLiteral("/kirigami/icons")).removeRecursively();
+
+    QVERIFY(m_themes.isValid());
+    writeTheme({QStringLiteral("16x16/apps")});
+    QIcon::setThemeSearchPaths({m_themes.path()});
+    QIcon::setThemeName(QStringLiteral("kirigamitest"));
+}
+
+void IconDiskCacheTest::writeTheme(const QStringList &directories)
+{
+    QDir dir(m_themes.path() + QStringLiteral("/kirigamitest"));
+    for (const QString &directory : directories) {
+        QVERIFY(dir.mkpath(directory));
+    }
+
+    QFile index(dir.filePath(QStringLiteral("index.theme")));
+    QVERIFY(index.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    index.write("[Icon Theme]\nName=Kirigami Test\nDirectories=" + directories.join(QLatin1Char(',')).toUtf8() + "\n");
+    for (const QString &directory : directories) {
+        index.write("\n[" + directory.toUtf8() + "]\nSize=16\n");
+    }
+}
+
+IconCacheKey IconDiskCacheTest::key()
+{
+    IconCacheKey key;
+    key.source = QStringLiteral("document-open");
+    key.size = QSize(16, 16);
+    return key;
+}
+
+void IconDiskCacheTest::cacheHit()
+{
+    IconDiskCache cache;
+    QVERIFY(cache.isEnabled());
+
+    const QString path = cache.filePath(key());
+    QVERIFY(!path.isEmpty());
+    QVERIFY(IconDiskCache::load(path).isNull());
+
+    QImage image(16, 16, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::red);
+    IconDiskCache::save(path, image);
+
+    //same key, same file, same pixels
+    QCOMPARE(cache.filePath(key()), path);
+    QCOMPARE(IconDiskCache::load(path), image);
+
+    //valid for another process with the theme untouched
+    IconDiskCache otherCache;
+    QCOMPARE(otherCache.filePath(key()), path);
+    QCOMPARE(IconDiskCache::load(path), image);
+}
+
+void IconDiskCacheTest::themeModified()
+{
+    IconDiskCache cache;
+    const QString path = cache.filePath(key());
+    QImage image(16, 16, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::blue);
+    IconDiskCache::save(path, image);
+    QVERIFY(!IconDiskCache::load(path).isNull());
+
+    //a theme update, while the application is running
+    writeTheme({QStringLiteral("16x16/apps"), QStringLiteral("22x22/apps")});
+    cache.checkTheme();
+
+    QVERIFY(!QFile::exists(path));
+    QVERIFY(IconDiskCache::load(path).isNull());
+    //the same key still maps to the same file, to be filled again
+    QCOMPARE(cache.filePath(key()), path);
+}
+
+QTEST_MAIN(IconDiskCacheTest)
+
+#include "icondiskcachetest.moc"
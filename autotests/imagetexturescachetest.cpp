@@ -0,0 +1,103 @@
+/*
+ *   Copyright 2017 Marco Martin <mart@kde.org>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Library General Public License as
+ *   published by the Free Software Foundation; either version 2, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Library General Public License for more details
+ *
+ *   You should have received a copy of the GNU Library General Public
+ *   License along with this program; if not, write to the
+ *   Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <QtTest>
+#include <QQuickWindow>
+#include <QSGRendererInterface>
+#include <QSGTexture>
+
+#include "imagetexturescache.h"
+
+class ImageTexturesCacheTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void evictions();
+
+private:
+    static QImage image(const QColor &color);
+};
+
+void ImageTexturesCacheTest::initTestCase()
+{
+    //the software scene graph creates its textures in the gui thread, without graphics context
+    QQuickWindow::setSceneGraphBackend(QSGRendererInterface::Software);
+}
+
+QImage ImageTexturesCacheTest::image(const QColor &color)
+{
+    QImage image(100, 100, QImage::Format_ARGB32_Premultiplied);
+    image.fill(color);
+    return image;
+}
+
+void ImageTexturesCacheTest::evictions()
+{
+    //declared first, so it outlives the window
+    ImageTexturesCache cache;
+    QQuickWindow window;
+    window.resize(100, 100);
+    window.show();
+    QVERIFY(QTest::qWaitForWindowExposed(&window));
+
+    const qint64 imageBytes = 100 * 100 * 4;
+    cache.setMaximumUnusedBytes(3 * imageBytes);
+
+    QVector<QImage> images;
+    QVector<QSharedPointer<QSGTexture>> textures;
+    for (int i = 0; i < 5; ++i) {
+        images << image(QColor::fromHsv(i * 60, 255, 255));
+        //out of the atlas, so each texture owns its memory
+        textures << cache.loadTexture(&window, images.last(), 0);
+        if (!textures.last()) {
+            QSKIP("Textures can't be created on this platform");
+        }
+    }
+
+    ImageTexturesCache::Statistics stats = cache.statistics();
+    QCOMPARE(stats.misses, quint64(5));
+    QCOMPARE(stats.bytes, 5 * imageBytes);
+    QCOMPARE(stats.unusedBytes, qint64(0));
+    //over the budget, but still in use: never evicted
+    QCOMPARE(stats.evictions, quint64(0));
+
+    //released in order: the first two don't fit in the budget anymore
+    textures.clear();
+    stats = cache.statistics();
+    QCOMPARE(stats.evictions, quint64(2));
+    QCOMPARE(stats.unusedBytes, 3 * imageBytes);
+    QCOMPARE(stats.bytes, 3 * imageBytes);
+    QCOMPARE(stats.windowBytes.value(&window), 3 * imageBytes);
+
+    //the most recently used is still there, the least recently used has to be created again
+    QSharedPointer<QSGTexture> kept = cache.loadTexture(&window, images.at(4), 0);
+    QSharedPointer<QSGTexture> evicted = cache.loadTexture(&window, images.at(0), 0);
+    QVERIFY(kept);
+    QVERIFY(evicted);
+    stats = cache.statistics();
+    QCOMPARE(stats.hits, quint64(1));
+    QCOMPARE(stats.misses, quint64(6));
+    QCOMPARE(stats.unusedBytes, 2 * imageBytes);
+}
+
+QTEST_MAIN(ImageTexturesCacheTest)
+
+#include "imagetexturescachetest.moc"
@@ -0,0 +1,319 @@
+/*
+ *   Copyright 2026 agent <agent@local>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Library General Public License as
+ *   published by the Free Software Foundation; either version 2, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details
+ *
+ *   You should have received a copy of the GNU Library General Public
+ *   License along with this program; if not, write to the
+ *   Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <QtTest>
+#include <QBuffer>
+#include <QNetworkAccessManager>
+#include <QTcpServer>
+#include <QTcpSocket>
+
+#include "icondiskcache.h"
+#include "iconrasterizer.h"
+#include "remoteimageloader.h"
+
+/*
+ * A tiny http server, answering by path:
+ * /image.png the test image,
+ * /nostore.png the test image, not to be cached,
+ * /redirect/N a redirection to /redirect/N-1, /redirect/0 being the image,
+ * anything else a 404.
+ */
+class ImageServer : public QObject
+{
+public:
+    ImageServer()
+    {
+        QImage image(256, 128, QImage::Format_ARGB32);
+        image.fill(Qt::red);
+        QBuffer buffer(&m_image);
+        buffer.open(QIODevice::WriteOnly);
+        image.save(&buffer, "PNG");
+
+        connect(&m_server, &QTcpServer::newConnection, this, &ImageServer::accept);
+        m_server.listen(QHostAddress::LocalHost);
+    }
+
+    QUrl url(const QString &path) const
+    {
+        return QUrl(QStringLiteral("http://127.0.0.1:%1%2").arg(m_server.serverPort()).arg(path));
+    }
+
+    //paths asked for, query included
+    QStringList requests;
+
+private:
+    void accept()
+    {
+        while (QTcpSocket *socket = m_server.nextPendingConnection()) {
+            connect(socket, &QTcpSocket::readyRead, this, [this, socket]() {
+                m_buffers[socket].append(socket->readAll());
+                if (m_buffers[socket].contains("\r\n\r\n")) {
+                    respond(socket, m_buffers.take(socket));
+                }
+            });
+            connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+        }
+    }
+
+    void respond(QTcpSocket *socket, const QByteArray &request)
+    {
+        //"GET /path HTTP/1.1"
+        const QString target = QString::fromLatin1(request.split(' ').value(1));
+        requests << target;
+        const QString path = QUrl(target).path();
+
+        QByteArray response;
+        if (path.startsWith(QLatin1String("/redirect/")) && path.mid(10).toInt() > 0) {
+            const QString next = QStringLiteral("/redirect/%1").arg(path.mid(10).toInt() - 1);
+            response = "HTTP/1.1 302 Found\r\nLocation: " + url(next).toEncoded()
+                + "\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+        } else if (path == QLatin1String("/image.png") || path == QLatin1String("/redirect/0")
+                   || path == QLatin1String("/nostore.png")) {
+            response = "HTTP/1.1 200 OK\r\nContent-Type: image/png\r\n"
+                + QByteArray(path == QLatin1String("/nostore.png") ? "Cache-Control: no-store\r\n" : "")
+                + "Content-Length: "
+                + QByteArray::number(m_image.size()) + "\r\nConnection: close\r\n\r\n" + m_image;
+        } else {
+            response = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+        }
+        socket->write(response);
+        socket->disconnectFromHost();
+    }
+
+    QTcpServer m_server;
+    QByteArray m_image;
+    QHash<QTcpSocket *, QByteArray> m_buffers;
+};
+
+class RemoteImageLoaderTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void init();
+    void cleanup();
+    void mergedRequests();
+    void decodedCache();
+    void encodedCache();
+    void diskCache();
+    void diskCacheNoStore();
+    void diskCachePrune();
+    void redirectLimit_data();
+    void redirectLimit();
+    void failingUrl();
+
+private:
+    //loads @p url with @p loader, and waits for the result
+    QImage load(RemoteImageLoader *loader, const QUrl &url, const QSize &size);
+    //a url nothing has been cached for yet
+    QUrl freshUrl(const QString &path);
+
+    QNetworkAccessManager m_qnam;
+    QScopedPointer<ImageServer> m_server;
+    int m_urls = 0;
+};
+
+void RemoteImageLoaderTest::initTestCase()
+{
+    //read once, by the first use of the disk cache
+    qputenv("KIRIGAMI_ICON_DISK_CACHE", "1");
+    QStandardPaths::setTestModeEnabled(true);
+    QDir(QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + QStringLiteral("/kirigami/remote")).removeRecursively();
+    QVERIFY(IconDiskCache::self()->isEnabled());
+}
+
+void RemoteImageLoaderTest::init()
+{
+    m_server.reset(new ImageServer);
+}
+
+void RemoteImageLoaderTest::cleanup()
+{
+    //the jobs still running point to the loaders of the test
+    IconRasterizer::self()->threadPool()->waitForDone();
+    QCoreApplication::processEvents();
+}
+
+QImage RemoteImageLoaderTest::load(RemoteImageLoader *loader, const QUrl &url, const QSize &size)
+{
+    bool done = false;
+    QImage result;
+    loader->load(&m_qnam, url, size, this, [&done, &result](const QImage &image) {
+        done = true;
+        result = image;
+    });
+    QTRY_VERIFY_WITH_TIMEOUT(done, 10000);
+    return result;
+}
+
+QUrl RemoteImageLoaderTest::freshUrl(const QString &path)
+{
+    QUrl url = m_server->url(path);
+    url.setQuery(QStringLiteral("n=%1").arg(++m_urls));
+    return url;
+}
+
+void RemoteImageLoaderTest::mergedRequests()
+{
+    RemoteImageLoader loader;
+    const QUrl url = freshUrl(QStringLiteral("/image.png"));
+
+    QVector<QImage> images;
+    auto callback = [&images](const QImage &image) {
+        images << image;
+    };
+    loader.load(&m_qnam, url, QSize(64, 64), this, callback);
+    loader.load(&m_qnam, url, QSize(64, 64), this, callback);
+    loader.load(&m_qnam, url, QSize(32, 32), this, callback);
+    QTRY_COMPARE_WITH_TIMEOUT(images.count(), 3, 10000);
+
+    //a single download for all of them, decoded at the size they asked for
+    QCOMPARE(m_server->requests.count(), 1);
+    for (const QImage &image : images) {
+        QVERIFY(!image.isNull());
+    }
+    QVERIFY(images.at(0).size() == QSize(128, 64) || images.at(0).size() == QSize(64, 32));
+}
+
+void RemoteImageLoaderTest::decodedCache()
+{
+    RemoteImageLoader loader;
+    const QUrl url = freshUrl(QStringLiteral("/image.png"));
+
+    QVERIFY(loader.cachedImage(url, QSize(64, 64)).isNull());
+    const QImage image = load(&loader, url, QSize(64, 64));
+    QVERIFY(!image.isNull());
+
+    //scaled down to cover the size, never up
+    QCOMPARE(image.size(), QSize(128, 64));
+    QCOMPARE(loader.cachedImage(url, QSize(64, 64)), image);
+    QVERIFY(loader.cachedImage(url, QSize(32, 32)).isNull());
+}
+
+void RemoteImageLoaderTest::encodedCache()
+{
+    RemoteImageLoader loader;
+    const QUrl url = freshUrl(QStringLiteral("/image.png"));
+
+    QVERIFY(!load(&loader, url, QSize(64, 64)).isNull());
+    QCOMPARE(m_server->requests.count(), 1);
+
+    //decoded again from the data already downloaded
+    const QImage image = load(&loader, url, QSize(32, 32));
+    QCOMPARE(image.size(), QSize(64, 32));
+    QCOMPARE(m_server->requests.count(), 1);
+}
+
+void RemoteImageLoaderTest::diskCache()
+{
+    const QUrl url = freshUrl(QStringLiteral("/image.png"));
+    const QString path = IconDiskCache::self()->remoteFilePath(url, QSize(64, 64));
+    QVERIFY(!path.isEmpty());
+
+    {
+        RemoteImageLoader loader;
+        QVERIFY(!load(&loader, url, QSize(64, 64)).isNull());
+    }
+    //saved before being delivered
+    QVERIFY(QFile::exists(path));
+    QCOMPARE(m_server->requests.count(), 1);
+
+    //a loader with empty memory caches, as after a restart
+    RemoteImageLoader loader;
+    const QImage image = load(&loader, url, QSize(64, 64));
+    QCOMPARE(image.size(), QSize(128, 64));
+    QCOMPARE(m_server->requests.count(), 1);
+}
+
+void RemoteImageLoaderTest::diskCacheNoStore()
+{
+    const QUrl url = freshUrl(QStringLiteral("/nostore.png"));
+
+    {
+        RemoteImageLoader loader;
+        QVERIFY(!load(&loader, url, QSize(64, 64)).isNull());
+    }
+    QVERIFY(!QFile::exists(IconDiskCache::self()->remoteFilePath(url, QSize(64, 64))));
+
+    //downloaded again by a loader with empty memory caches
+    RemoteImageLoader loader;
+    QVERIFY(!load(&loader, url, QSize(64, 64)).isNull());
+    QCOMPARE(m_server->requests.count(), 2);
+}
+
+void RemoteImageLoaderTest::diskCachePrune()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    for (int i = 0; i < 4; ++i) {
+        QFile file(dir.path() + QStringLiteral("/file%1").arg(i));
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        file.write(QByteArray(1000, 'x'));
+    }
+    //being written, never pruned
+    QFile partial(dir.path() + QStringLiteral("/file0.abcdef"));
+    QVERIFY(partial.open(QIODevice::WriteOnly));
+    partial.write(QByteArray(1000, 'x'));
+    partial.close();
+
+    IconDiskCache::prune(dir.path(), 2500);
+    QCOMPARE(QDir(dir.path()).entryList(QDir::Files).count(), 3);
+    QVERIFY(partial.exists());
+}
+
+void RemoteImageLoaderTest::redirectLimit_data()
+{
+    QTest::addColumn<int>("redirects");
+    QTest::addColumn<bool>("loaded");
+
+    QTest::newRow("one") << 1 << true;
+    QTest::newRow("at the limit") << 10 << true;
+    QTest::newRow("over the limit") << 11 << false;
+}
+
+void RemoteImageLoaderTest::redirectLimit()
+{
+    QFETCH(int, redirects);
+    QFETCH(bool, loaded);
+
+    RemoteImageLoader loader;
+    const QImage image = load(&loader, freshUrl(QStringLiteral("/redirect/%1").arg(redirects)), QSize(64, 64));
+    QCOMPARE(!image.isNull(), loaded);
+    //the redirection over the limit is not followed
+    QCOMPARE(m_server->requests.count(), qMin(redirects, 10) + 1);
+}
+
+void RemoteImageLoaderTest::failingUrl()
+{
+    RemoteImageLoader loader;
+    const QUrl url = freshUrl(QStringLiteral("/missing.png"));
+
+    QVERIFY(load(&loader, url, QSize(64, 64)).isNull());
+    QVERIFY(loader.cachedImage(url, QSize(64, 64)).isNull());
+    QCOMPARE(m_server->requests.count(), 1);
+
+    //failures are not cached, asking again downloads again
+    QVERIFY(load(&loader, url, QSize(64, 64)).isNull());
+    QCOMPARE(m_server->requests.count(), 2);
+}
+
+QTEST_MAIN(RemoteImageLoaderTest)
+
+#include "remoteimageloadertest.moc"
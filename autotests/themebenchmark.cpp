@@ -0,0 +1,254 @@
+/*
+ *   Copyright 2017 Marco Martin <mart@kde.org>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Library General Public License as
+ *   published by the Free Software Foundation; either version 2, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details
+ *
+ *   You should have received a copy of the GNU Library General Public
+ *   License along with this program; if not, write to the
+ *   Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <QtTest>
+#include <QQmlComponent>
+#include <QQmlContext>
+#include <QQmlEngine>
+#include <QQuickItem>
+
+#include <platformtheme.h>
+
+using Kirigami::PlatformTheme;
+
+/**
+ * Benchmarks of the PlatformTheme and BasicTheme hot paths.
+ *
+ * Run with "-o results.xml,xml" (or csv, lightxml, teamcity) to get the
+ * results in a machine readable form. Not part of the autotests: configure
+ * with -DBUILD_BENCHMARKS=ON and "ctest -L benchmark" runs it, writing
+ * themebenchmark.xml in the build directory.
+ */
+class ThemeBenchmark : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void createTree_data();
+    void createTree();
+    void attachThemes_data();
+    void attachThemes();
+    void propagateColorSet_data();
+    void propagateColorSet();
+    void syncColors();
+    void paletteChangeLatency_data();
+    void paletteChangeLatency();
+
+private:
+    //items chains of depth items each under the returned root
+    QQuickItem *createTree(int items, int depth, QVector<QQuickItem *> *allItems = Q_NULLPTR);
+    static PlatformTheme *theme(QQuickItem *item);
+
+    QQmlEngine *m_engine = Q_NULLPTR;
+    QObject *m_qmlTheme = Q_NULLPTR;
+};
+
+void ThemeBenchmark::initTestCase()
+{
+    //measure BasicTheme, not whatever style plugin is installed on the system
+    QCoreApplication::setLibraryPaths(QStringList());
+
+    m_engine = new QQmlEngine(this);
+    QQmlComponent component(m_engine);
+    component.setData("import QtQuick 2.6\n"
+                      "import org.kde.kirigami 2.0 as Kirigami\n"
+                      "QtObject { property QtObject theme: Kirigami.Theme }", QUrl());
+    QObject *holder = component.create();
+    QVERIFY2(holder, qPrintable(component.errorString()));
+    holder->setParent(this);
+    m_qmlTheme = holder->property("theme").value<QObject *>();
+    QVERIFY(m_qmlTheme);
+}
+
+void ThemeBenchmark::cleanupTestCase()
+{
+    delete m_engine;
+    m_engine = Q_NULLPTR;
+}
+
+QQuickItem *ThemeBenchmark::createTree(int items, int depth, QVector<QQuickItem *> *allItems)
+{
+    QQuickItem *root = new QQuickItem;
+    //themes need the items to belong to an engine
+    QQmlEngine::setContextForObject(root, m_engine->rootContext());
+
+    for (int i = 0; i < items; i += depth) {
+        QQuickItem *parent = root;
+        for (int level = 0; level < depth && i + level < items; ++level) {
+            QQuickItem *item = new QQuickItem(parent);
+            QQmlEngine::setContextForObject(item, m_engine->rootContext());
+            item->setParentItem(parent);
+            if (allItems) {
+                allItems->append(item);
+            }
+            parent = item;
+        }
+    }
+
+    return root;
+}
+
+PlatformTheme *ThemeBenchmark::theme(QQuickItem *item)
+{
+    return static_cast<PlatformTheme *>(qmlAttachedPropertiesObject<PlatformTheme>(item, true));
+}
+
+void ThemeBenchmark::createTree_data()
+{
+    QTest::addColumn<int>("items");
+    QTest::addColumn<int>("depth");
+
+    QTest::newRow("1000 flat") << 1000 << 1;
+    QTest::newRow("1000 depth 10") << 1000 << 10;
+    QTest::newRow("1000 depth 100") << 1000 << 100;
+}
+
+void ThemeBenchmark::createTree()
+{
+    //baseline for attachThemes: the same trees without any theme
+    QFETCH(int, items);
+    QFETCH(int, depth);
+
+    QBENCHMARK {
+        delete createTree(items, depth);
+    }
+}
+
+void ThemeBenchmark::attachThemes_data()
+{
+    createTree_data();
+}
+
+void ThemeBenchmark::attachThemes()
+{
+    QFETCH(int, items);
+    QFETCH(int, depth);
+
+    QBENCHMARK {
+        QVector<QQuickItem *> allItems;
+        QQuickItem *root = createTree(items, depth, &allItems);
+        theme(root);
+        for (QQuickItem *item : allItems) {
+            theme(item);
+        }
+        delete root;
+    }
+}
+
+void ThemeBenchmark::propagateColorSet_data()
+{
+    createTree_data();
+}
+
+void ThemeBenchmark::propagateColorSet()
+{
+    QFETCH(int, items);
+    QFETCH(int, depth);
+
+    QVector<QQuickItem *> allItems;
+    QScopedPointer<QQuickItem> root(createTree(items, depth, &allItems));
+    PlatformTheme *rootTheme = theme(root.data());
+    for (QQuickItem *item : allItems) {
+        theme(item);
+    }
+
+    QBENCHMARK {
+        rootTheme->setColorSet(PlatformTheme::View);
+        rootTheme->setColorSet(PlatformTheme::Window);
+    }
+
+    rootTheme->setColorSet(PlatformTheme::Complementary);
+    for (QQuickItem *item : allItems) {
+        QCOMPARE(theme(item)->colorSet(), PlatformTheme::Complementary);
+    }
+}
+
+void ThemeBenchmark::syncColors()
+{
+    //a single theme not inherited by anyone: it's all about resolving its colors
+    QScopedPointer<QQuickItem> root(createTree(1, 1));
+    PlatformTheme *t = theme(root->childItems().first());
+    t->setInherit(false);
+
+    QBENCHMARK {
+        t->setColorSet(PlatformTheme::Button);
+        t->setColorSet(PlatformTheme::Window);
+    }
+
+    t->setColorSet(PlatformTheme::Complementary);
+    QCOMPARE(t->textColor(), m_qmlTheme->property("complementaryTextColor").value<QColor>());
+}
+
+void ThemeBenchmark::paletteChangeLatency_data()
+{
+    QTest::addColumn<int>("items");
+
+    QTest::newRow("100") << 100;
+    QTest::newRow("1000") << 1000;
+    QTest::newRow("5000") << 5000;
+}
+
+void ThemeBenchmark::paletteChangeLatency()
+{
+    QFETCH(int, items);
+
+    QVector<QQuickItem *> allItems;
+    QScopedPointer<QQuickItem> root(createTree(items, 10, &allItems));
+    int notified = 0;
+    for (QQuickItem *item : allItems) {
+        connect(theme(item), &PlatformTheme::colorsChanged, this, [&notified]() {
+            ++notified;
+        });
+    }
+    //let the initial notifications go
+    QCoreApplication::processEvents();
+
+    const QColor colors[2] = {QColor(Qt::red), QColor(Qt::blue)};
+    int round = 0;
+
+    //the guard is a timer, so waiting measures nothing but the event loop
+    bool timedOut = false;
+    QTimer timeout;
+    timeout.setSingleShot(true);
+    connect(&timeout, &QTimer::timeout, this, [&timedOut]() {
+        timedOut = true;
+    });
+    timeout.start(60000);
+
+    QBENCHMARK {
+        notified = 0;
+        m_qmlTheme->setProperty("textColor", colors[round++ % 2]);
+        //from the change in the QML theme to the last colorsChanged
+        while (notified < items && !timedOut) {
+            QCoreApplication::processEvents();
+        }
+    }
+    QVERIFY2(!timedOut, "colorsChanged was not emitted for all the items");
+
+    //colorsChanged is compressed: only one per theme per change
+    QCoreApplication::processEvents();
+    QCOMPARE(notified, items);
+}
+
+QTEST_MAIN(ThemeBenchmark)
+
+#include "themebenchmark.moc"
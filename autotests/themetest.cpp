@@ -0,0 +1,138 @@
+/*
+ *   Copyright 2017 Marco Martin <mart@kde.org>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Library General Public License as
+ *   published by the Free Software Foundation; either version 2, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Library General Public License for more details
+ *
+ *   You should have received a copy of the GNU Library General Public
+ *   License along with this program; if not, write to the
+ *   Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <QtTest>
+#include <QQmlComponent>
+#include <QQmlContext>
+#include <QQmlEngine>
+#include <QQuickItem>
+
+#include <platformtheme.h>
+#include <platformtheme_p.h>
+
+using Kirigami::PlatformTheme;
+
+class ThemeTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void reparentInheritsColorSet();
+    void siblingsShareData();
+
+private:
+    QQuickItem *createItem(QQuickItem *parent = Q_NULLPTR);
+    static PlatformTheme *theme(QQuickItem *item);
+
+    QQmlEngine *m_engine = Q_NULLPTR;
+};
+
+void ThemeTest::initTestCase()
+{
+    //test BasicTheme, not whatever style plugin is installed on the system
+    QCoreApplication::setLibraryPaths(QStringList());
+
+    m_engine = new QQmlEngine(this);
+    //loads the plugin, which registers the attached Theme
+    QQmlComponent component(m_engine);
+    component.setData("import QtQuick 2.6\n"
+                      "import org.kde.kirigami 2.0 as Kirigami\n"
+                      "QtObject { property QtObject theme: Kirigami.Theme }", QUrl());
+    QScopedPointer<QObject> holder(component.create());
+    QVERIFY2(holder, qPrintable(component.errorString()));
+}
+
+void ThemeTest::cleanupTestCase()
+{
+    delete m_engine;
+    m_engine = Q_NULLPTR;
+}
+
+QQuickItem *ThemeTest::createItem(QQuickItem *parent)
+{
+    QQuickItem *item = new QQuickItem(parent);
+    //themes need the items to belong to an engine
+    QQmlEngine::setContextForObject(item, m_engine->rootContext());
+    item->setParentItem(parent);
+    return item;
+}
+
+PlatformTheme *ThemeTest::theme(QQuickItem *item)
+{
+    return static_cast<PlatformTheme *>(qmlAttachedPropertiesObject<PlatformTheme>(item, true));
+}
+
+void ThemeTest::reparentInheritsColorSet()
+{
+    QScopedPointer<QQuickItem> view(createItem());
+    QScopedPointer<QQuickItem> complementary(createItem());
+    theme(view.data())->setColorSet(PlatformTheme::View);
+    theme(complementary.data())->setColorSet(PlatformTheme::Complementary);
+
+    //an item without theme in between
+    QQuickItem *item = createItem(createItem(view.data()));
+    QQuickItem *child = createItem(item);
+    QCOMPARE(theme(item)->colorSet(), PlatformTheme::View);
+    QCOMPARE(theme(child)->colorSet(), PlatformTheme::View);
+
+    QSignalSpy spy(theme(child), &PlatformTheme::colorSetChanged);
+    item->setParentItem(complementary.data());
+    //right away, not on the next event loop iteration
+    QCOMPARE(theme(item)->colorSet(), PlatformTheme::Complementary);
+    QCOMPARE(theme(child)->colorSet(), PlatformTheme::Complementary);
+    QCOMPARE(spy.count(), 1);
+
+    //not inheriting: stays as it is
+    theme(item)->setInherit(false);
+    item->setParentItem(view.data());
+    QCOMPARE(theme(item)->colorSet(), PlatformTheme::Complementary);
+    theme(item)->setInherit(true);
+    QCOMPARE(theme(item)->colorSet(), PlatformTheme::View);
+    QCOMPARE(theme(child)->colorSet(), PlatformTheme::View);
+}
+
+void ThemeTest::siblingsShareData()
+{
+    QScopedPointer<QQuickItem> parent(createItem());
+    theme(parent.data())->setColorSet(PlatformTheme::View);
+    QCoreApplication::processEvents();
+
+    QQuickItem *first = createItem(parent.data());
+    QQuickItem *second = createItem(parent.data());
+    //inheriting, with the same colors as the parent: its very block
+    QCOMPARE(Kirigami::platformThemeDataBlock(theme(first)), Kirigami::platformThemeDataBlock(theme(parent.data())));
+    QCOMPARE(Kirigami::platformThemeDataBlock(theme(second)), Kirigami::platformThemeDataBlock(theme(first)));
+
+    theme(first)->setColorSet(PlatformTheme::Complementary);
+    QCoreApplication::processEvents();
+    QVERIFY(Kirigami::platformThemeDataBlock(theme(first)) != Kirigami::platformThemeDataBlock(theme(second)));
+    QCOMPARE(Kirigami::platformThemeDataBlock(theme(second)), Kirigami::platformThemeDataBlock(theme(parent.data())));
+
+    //same settings again, found in the pool
+    theme(second)->setColorSet(PlatformTheme::Complementary);
+    QCoreApplication::processEvents();
+    QCOMPARE(Kirigami::platformThemeDataBlock(theme(second)), Kirigami::platformThemeDataBlock(theme(first)));
+}
+
+QTEST_MAIN(ThemeTest)
+
+#include "themetest.moc"
@@ -70,7 +70,11 @@ TestCase {
     }
 
     function init() {
+        mainWindow.pageStack.unloadDistance = -1
+        mainWindow.pageStack.recycledContainers = 0
         mainWindow.pageStack.clear()
+        mainWindow.pageStack.defaultColumnWidth = Kirigami.Units.gridUnit * 20
+        testCase.livePages = {}
         spyActive.clear()
         spyCurrentIndex.clear()
     }
@@ -107,6 +111,154 @@ TestCase {
         compare(mainWindow.pageStack.depth, 1)
     }
 
+    function test_pushArray() {
+        compare(mainWindow.pageStack.depth, 0)
+        mainWindow.pageStack.push([randomPage, randomPage, {"page": randomPage, "properties": {"title": "last"}}])
+        compare(mainWindow.pageStack.depth, 3)
+        compare(mainWindow.pageStack.currentIndex, 2)
+        compare(mainWindow.pageStack.lastItem.title, "last")
+
+        //pages already in the row are not pushed again
+        mainWindow.pageStack.push(mainWindow.pageStack.get(1))
+        compare(mainWindow.pageStack.depth, 3)
+    }
+
+    function test_unwind() {
+        for (var i = 0; i < 20; ++i) {
+            mainWindow.pageStack.push(randomPage)
+        }
+        compare(mainWindow.pageStack.depth, 20)
+        mainWindow.pageStack.pop(mainWindow.pageStack.get(4))
+        compare(mainWindow.pageStack.depth, 5)
+        mainWindow.pageStack.pop(mainWindow.pageStack.get(0))
+        compare(mainWindow.pageStack.depth, 1)
+    }
+
+    property int liveStatefulPages: 0
+    Component {
+        id: statefulPage
+        Kirigami.Page {
+            property string text
+            function saveState() {
+                return {"text": text};
+            }
+            function restoreState(state) {
+                text = state.text;
+            }
+            Component.onCompleted: testCase.liveStatefulPages++
+            Component.onDestruction: testCase.liveStatefulPages--
+        }
+    }
+
+    function test_unloadPages() {
+        mainWindow.pageStack.unloadDistance = 1
+        var first = mainWindow.pageStack.push(statefulPage)
+        first.text = "edited"
+        for (var i = 0; i < 5; ++i) {
+            mainWindow.pageStack.push(statefulPage)
+        }
+        compare(mainWindow.pageStack.depth, 6)
+        //only the current page and its neighbour are still around
+        tryCompare(testCase, "liveStatefulPages", 2)
+
+        mainWindow.pageStack.currentIndex = 0
+        compare(mainWindow.pageStack.currentItem.text, "edited")
+
+        mainWindow.pageStack.unloadDistance = -1
+        tryCompare(testCase, "liveStatefulPages", 6)
+    }
+
+    property var livePages: ({})
+    Component {
+        id: namedPage
+        Kirigami.Page {
+            property string name
+            Component.onCompleted: testCase.livePages[name] = true
+            Component.onDestruction: delete testCase.livePages[name]
+        }
+    }
+
+    function test_unloadPagesWideMode() {
+        //480px are two and a bit columns
+        mainWindow.pageStack.defaultColumnWidth = 200
+        mainWindow.pageStack.unloadDistance = 0
+        for (var i = 0; i < 6; ++i) {
+            mainWindow.pageStack.push(namedPage, {"name": "page" + i})
+        }
+        verify(mainWindow.pageStack.wideMode)
+        compare(mainWindow.pageStack.currentIndex, 5)
+
+        //the current page is the right-most column, the ones on its left are visible too
+        for (var tries = 0; tries < 40 && testCase.livePages["page0"]; ++tries) {
+            wait(50)
+        }
+        verify(!testCase.livePages["page0"])
+        verify(testCase.livePages["page4"])
+        verify(testCase.livePages["page5"])
+    }
+
+    property int liveOwnerPages: 0
+    Component {
+        id: ownerPage
+        Kirigami.Page {
+            property QtObject helper: QtObject {
+                property string text: "kept"
+            }
+            Component.onCompleted: testCase.liveOwnerPages++
+            Component.onDestruction: testCase.liveOwnerPages--
+        }
+    }
+    Component {
+        id: referringPage
+        Kirigami.Page {
+            property QtObject source
+            Component.onCompleted: testCase.liveStatefulPages++
+            Component.onDestruction: testCase.liveStatefulPages--
+        }
+    }
+
+    function test_unloadKeepsObjectProperties() {
+        mainWindow.pageStack.unloadDistance = 0
+        var owner = mainWindow.pageStack.push(ownerPage)
+        mainWindow.pageStack.push(referringPage, {"source": owner.helper})
+        for (var i = 0; i < 4; ++i) {
+            mainWindow.pageStack.push(statefulPage)
+        }
+        compare(mainWindow.pageStack.depth, 6)
+        //the referring page is unloaded, but not the page its object belongs to
+        tryCompare(testCase, "liveStatefulPages", 1)
+        compare(testCase.liveOwnerPages, 1)
+
+        mainWindow.pageStack.currentIndex = 1
+        verify(mainWindow.pageStack.currentItem.source)
+        compare(mainWindow.pageStack.currentItem.source.text, "kept")
+
+        //once the referring page is gone, the owner can be unloaded too
+        mainWindow.pageStack.currentIndex = 5
+        mainWindow.pageStack.pop(mainWindow.pageStack.get(0))
+        mainWindow.pageStack.push(statefulPage)
+        mainWindow.pageStack.push(statefulPage)
+        tryCompare(testCase, "liveOwnerPages", 0)
+    }
+
+    function test_recycleContainers() {
+        mainWindow.pageStack.recycledContainers = 1
+        mainWindow.pageStack.push(statefulPage)
+        var popped = mainWindow.pageStack.push(statefulPage)
+        var container = popped.parent
+        verify(container)
+        tryCompare(testCase, "liveStatefulPages", 2)
+
+        mainWindow.pageStack.pop()
+        tryCompare(testCase, "liveStatefulPages", 1)
+        //the container of the popped page is still around, and wraps the next page
+        verify(container)
+        var pushed = mainWindow.pageStack.push(statefulPage)
+        verify(pushed.parent === container)
+        compare(container.level, 1)
+        compare(mainWindow.pageStack.depth, 2)
+    }
+
     property int destructions: 0
     Component {
         id: destroyedPage
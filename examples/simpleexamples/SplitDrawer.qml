@@ -29,7 +29,7 @@ Kirigami.ApplicationWindow {
 
 
     pageStack.initialPage: mainPageComponent
-    globalDrawer: Kirigami.SplitDrawer {
+    globalDrawer: Kirigami.OverlayDrawer {
         id: drawer
         drawerOpen: true
         //modal: false
@@ -3,12 +3,14 @@ QT          += qml quick gui svg quickcontrols2
 HEADERS     += $$PWD/src/kirigamiplugin.h \
                $$PWD/src/enums.h \
                $$PWD/src/settings.h \
+               $$PWD/src/pagerowmodel.h \
                $$PWD/src/libkirigami/basictheme_p.h \
                $$PWD/src/libkirigami/platformtheme.h \
                $$PWD/src/libkirigami/kirigamipluginfactory.h
 SOURCES     += $$PWD/src/kirigamiplugin.cpp \
                $$PWD/src/enums.cpp \
                $$PWD/src/settings.cpp \
+               $$PWD/src/pagerowmodel.cpp \
                $$PWD/src/libkirigami/basictheme.cpp \
                $$PWD/src/libkirigami/platformtheme.cpp \
                $$PWD/src/libkirigami/kirigamipluginfactory.cpp
@@ -17,14 +19,29 @@ DEFINES     += KIRIGAMI_BUILD_TYPE_STATIC
 
 !ios:!android {
     message( "compiling for desktop" )
-    HEADERS += $$PWD/src/desktopicon.h
-    SOURCES += $$PWD/src/desktopicon.cpp
+    HEADERS += $$PWD/src/desktopicon.h \
+               $$PWD/src/icondiskcache.h \
+               $$PWD/src/iconrasterizer.h \
+               $$PWD/src/imagetexturescache.h \
+               $$PWD/src/maskedtexturenode.h \
+               $$PWD/src/remoteimageloader.h
+    SOURCES += $$PWD/src/desktopicon.cpp \
+               $$PWD/src/icondiskcache.cpp \
+               $$PWD/src/iconrasterizer.cpp \
+               $$PWD/src/imagetexturescache.cpp \
+               $$PWD/src/maskedtexturenode.cpp \
+               $$PWD/src/remoteimageloader.cpp
 }
 
 API_VER=1.0
 
 RESOURCES += $$PWD/kirigami.qrc
 
+#CONFIG+=kirigami_qmlcache embeds the QML components compiled ahead of time (Qt >= 5.11)
+kirigami_qmlcache {
+    CONFIG += qtquickcompiler
+}
+
 exists($$_PRO_FILE_PWD_/kirigami-icons.qrc) {
     message("Using icons QRC file shipped by the project")
     RESOURCES += $$_PRO_FILE_PWD_/kirigami-icons.qrc
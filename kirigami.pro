@@ -2,14 +2,24 @@ TEMPLATE = lib
 CONFIG += plugin
 
 QT          += qml quick gui svg
-HEADERS     += $$PWD/src/kirigamiplugin.h $$PWD/src/enums.h $$PWD/src/settings.h
-SOURCES     += $$PWD/src/kirigamiplugin.cpp $$PWD/src/enums.cpp $$PWD/src/settings.cpp
+HEADERS     += $$PWD/src/kirigamiplugin.h $$PWD/src/enums.h $$PWD/src/settings.h $$PWD/src/pagerowmodel.h
+SOURCES     += $$PWD/src/kirigamiplugin.cpp $$PWD/src/enums.cpp $$PWD/src/settings.cpp $$PWD/src/pagerowmodel.cpp
 RESOURCES   += $$PWD/kirigami.qrc
 
 !ios:!android {
     message( "compiling for desktop" )
-    HEADERS += $$PWD/src/desktopicon.h
-    SOURCES += $$PWD/src/desktopicon.cpp
+    HEADERS += $$PWD/src/desktopicon.h \
+               $$PWD/src/icondiskcache.h \
+               $$PWD/src/iconrasterizer.h \
+               $$PWD/src/imagetexturescache.h \
+               $$PWD/src/maskedtexturenode.h \
+               $$PWD/src/remoteimageloader.h
+    SOURCES += $$PWD/src/desktopicon.cpp \
+               $$PWD/src/icondiskcache.cpp \
+               $$PWD/src/iconrasterizer.cpp \
+               $$PWD/src/imagetexturescache.cpp \
+               $$PWD/src/maskedtexturenode.cpp \
+               $$PWD/src/remoteimageloader.cpp
 }
 
 API_VER=1.0
@@ -23,6 +23,7 @@ import QtQml.Models 2.2
 import QtQuick.Templates 2.0 as T
 import QtQuick.Controls 2.0 as QQC2
 import org.kde.kirigami 2.2
+import org.kde.kirigami.private 2.2 as KirigamiPrivate
 
 /**
  * PageRow implements a row-based navigation model, which can be used
@@ -98,6 +99,32 @@ T.Control {
      * @since 5.38
      */
     property bool separatorVisible: true
+
+    /**
+     * unloadDistance: int
+     * When zero or more, pages further than this number of columns from the
+     * visible ones are unloaded to save memory, and loaded again when the user
+     * navigates back to them, so deep rows don't keep growing in memory.
+     * Only pages pushed as a Component or url are unloaded, and never the last one
+     * or a page other pages in the row were created from or hold objects of.
+     * Before being unloaded a page can save its state with a
+     * "function saveState()", the returned value will be passed to its
+     * "function restoreState(state)" once it's loaded again.
+     * References to an unloaded page become null, get() loads it again.
+     * default: -1, all the pages are kept loaded
+     * @since 5.39
+     */
+    property int unloadDistance: -1
+
+    /**
+     * recycledContainers: int
+     * How many of the internal items wrapping the popped pages are kept
+     * around to be reused by the next pushes, instead of being destroyed
+     * and created again. Worth raising for rows often pushed and popped.
+     * default: 4 when unloadDistance is set, 0 otherwise
+     * @since 5.39
+     */
+    property int recycledContainers: unloadDistance >= 0 ? 4 : 0
 //END PROPERTIES
 
 //BEGIN FUNCTIONS
@@ -136,40 +163,11 @@ T.Control {
 
         popScrollAnim.popPageCleanup(currentItem);
 
-        // figure out if more than one page is being pushed
-        var pages;
-        if (page instanceof Array) {
-            pages = page;
-            page = pages.pop();
-            if (page.createObject === undefined && page.parent === undefined && typeof page != "string") {
-                properties = properties || page.properties;
-                page = page.page;
-            }
-        }
-
-        // push any extra defined pages onto the stack
-        if (pages) {
-            var i;
-            for (i = 0; i < pages.length; i++) {
-                var tPage = pages[i];
-                var tProps;
-                if (tPage.createObject === undefined && tPage.parent === undefined && typeof tPage != "string") {
-                    if (pagesLogic.containsPage(tPage)) {
-                        print("The item " + page + " is already in the PageRow");
-                        continue;
-                    }
-                    tProps = tPage.properties;
-                    tPage = tPage.page;
-                }
-
-                var container = pagesLogic.initPage(tPage, tProps);
-                pagesLogic.append(container);
-            }
+        // pushes all the pages at once if an array was given
+        var container = pagesLogic.push(page, properties || {});
+        if (!container) {
+            return null;
         }
-
-        // initialize the page
-        var container = pagesLogic.initPage(page, properties);
-        pagesLogic.append(container);
         container.visible = container.page.visible = true;
 
         mainView.currentIndex = container.level;
@@ -200,7 +198,7 @@ T.Control {
         popScrollAnim.from = mainView.contentX
 
         if ((!page || !page.parent) && pagesLogic.count > 1) {
-            page = pagesLogic.get(pagesLogic.count - 2).page;
+            page = pagesLogic.pageAt(pagesLogic.count - 2);
         }
         popScrollAnim.to = page && page.parent ? page.parent.x : 0;
         popScrollAnim.pendingPage = page;
@@ -223,16 +221,12 @@ T.Control {
                 popScrollAnim.running = false;
             }
 
-            var oldPage = pagesLogic.get(pagesLogic.count-1).page;
             if (page !== undefined) {
-                // an unwind target has been specified - pop until we find it
-                while (page != oldPage && pagesLogic.count > 1) {
-                    pagesLogic.removePage(oldPage.parent.level);
-
-                    oldPage = pagesLogic.get(pagesLogic.count-1).page;
-                }
+                // an unwind target has been specified - pop everything after it in one go,
+                // but never the first page
+                pagesLogic.removeFrom(Math.max(1, pagesLogic.indexOf(page) + 1));
             } else {
-                pagesLogic.removePage(pagesLogic.count-1);
+                pagesLogic.removeFrom(pagesLogic.count-1);
             }
         }
         NumberAnimation {
@@ -267,7 +261,7 @@ T.Control {
      */
     function replace(page, properties) {
         if (currentIndex>=1)
-            popScrollAnim.popPageCleanup(pagesLogic.get(currentIndex-1).page);
+            popScrollAnim.popPageCleanup(pagesLogic.pageAt(currentIndex-1));
         else if (currentIndex==0)
             popScrollAnim.popPageCleanup();
         else
@@ -280,7 +274,9 @@ T.Control {
      * Destroy (or reparent) all the pages contained.
      */
     function clear() {
-        return pagesLogic.clearPages();
+        popScrollAnim.running = false;
+        popScrollAnim.pendingDepth = -1;
+        pagesLogic.clear();
     }
 
     /**
@@ -288,7 +284,7 @@ T.Control {
      * @param idx the depth of the page we want
      */
     function get(idx) {
-        return pagesLogic.get(idx).page;
+        return pagesLogic.pageAt(idx);
     }
 
     /**
@@ -324,6 +320,8 @@ T.Control {
     property alias layers: layersStack
 //END FUNCTIONS
 
+    onUnloadDistanceChanged: pagesLogic.updateLoadedPages()
+
     onInitialPageChanged: {
         clear();
         if (initialPage) {
@@ -378,96 +376,13 @@ T.Control {
         onMovementEnded: currentIndex = Math.max(0, indexAt(contentX, 0))
         onFlickEnded: onMovementEnded();
         onCurrentIndexChanged: {
-            if (currentItem) {
+            pagesLogic.updateLoadedPages();
+            if (currentItem && currentItem.page) {
                 currentItem.page.forceActiveFocus();
             }
         }
         model: ObjectModel {
-            id: pagesLogic
-            readonly property var componentCache: new Array()
-            readonly property int roundedDefaultColumnWidth: root.width < root.defaultColumnWidth*2 ? root.width : root.defaultColumnWidth
-
-            function removePage(id) {
-                if (id < 0 || id >= count) {
-                    print("Tried to remove an invalid page index:" + id);
-                    return;
-                }
-
-                var item = pagesLogic.get(id);
-                if (item.owner) {
-                    item.page.visible = false;
-                    item.page.parent = item.owner;
-                }
-                //FIXME: why reparent ing is necessary?
-                //is destroy just an async deleteLater() that isn't executed immediately or it actually leaks?
-                pagesLogic.remove(id);
-                item.parent = root;
-                if (item.page.parent==item) {
-                    item.page.destroy(1)
-                }
-                item.destroy();
-            }
-            function clearPages () {
-                popScrollAnim.running = false;
-                popScrollAnim.pendingDepth = -1;
-                while (count > 0) {
-                    removePage(count-1);
-                }
-            }
-            function initPage(page, properties) {
-                var container = containerComponent.createObject(mainView, {
-                    "level": pagesLogic.count,
-                    "page": page
-                });
-
-                var pageComp;
-                if (page.createObject) {
-                    // page defined as component
-                    pageComp = page;
-                } else if (typeof page == "string") {
-                    // page defined as string (a url)
-                    pageComp = pagesLogic.componentCache[page];
-                    if (!pageComp) {
-                        pageComp = pagesLogic.componentCache[page] = Qt.createComponent(page);
-                    }
-                }
-                if (pageComp) {
-                    if (pageComp.status == Component.Error) {
-                        throw new Error("Error while loading page: " + pageComp.errorString());
-                    } else {
-                        // instantiate page from component
-                        page = pageComp.createObject(container.pageParent, properties || {});
-                    }
-                } else {
-                    // copy properties to the page
-                    for (var prop in properties) {
-                        if (properties.hasOwnProperty(prop)) {
-                            page[prop] = properties[prop];
-                        }
-                    }
-                }
-
-                container.page = page;
-                if (page.parent == null || page.parent == container.pageParent) {
-                    container.owner = null;
-                }
-
-                // the page has to be reparented
-                if (page.parent != container) {
-                    page.parent = container;
-                }
-
-                return container;
-            }
-            function containsPage(page) {
-                for (var i = 0; i < pagesLogic.count; ++i) {
-                    var candidate = pagesLogic.get(i);
-                    if (candidate.page == page) {
-                        print("The item " + page + " is already in the PageRow");
-                        return;
-                    }
-                }
-            }
+            id: pagesModel
         }
         T.ScrollIndicator.horizontal: T.ScrollIndicator {
             anchors {
@@ -500,6 +415,53 @@ T.Control {
         }
 
         onContentWidthChanged: mainView.positionViewAtIndex(root.currentIndex, ListView.Contain)
+        onContentXChanged: pagesLogic.updateVisibleColumns()
+        onWidthChanged: pagesLogic.updateVisibleColumns()
+    }
+
+    KirigamiPrivate.PageRowModel {
+        id: pagesLogic
+        model: pagesModel
+        delegate: containerComponent
+        view: mainView
+        containerPoolSize: root.recycledContainers
+        readonly property int roundedDefaultColumnWidth: root.width < root.defaultColumnWidth*2 ? root.width : root.defaultColumnWidth
+
+        // the columns the pages were last loaded around, as the view reported them
+        property int firstVisible: -1
+        property int lastVisible: -1
+
+        function updateLoadedPages() {
+            if (root.unloadDistance < 0) {
+                // load back anything unloaded while the mode was on
+                firstVisible = lastVisible = -1;
+                unloadOutside(0, count - 1);
+                return;
+            }
+            // the current column can be anywhere in the view, ask it what's visible
+            var first = mainView.indexAt(mainView.contentX, 0);
+            var last = mainView.indexAt(mainView.contentX + mainView.width - 1, 0);
+            firstVisible = first;
+            lastVisible = last;
+            if (first < 0) {
+                first = Math.max(0, mainView.currentIndex);
+            }
+            if (last < first) {
+                // past the end of the content
+                last = count - 1;
+            }
+            unloadOutside(first - root.unloadDistance, last + root.unloadDistance);
+        }
+
+        function updateVisibleColumns() {
+            if (root.unloadDistance < 0) {
+                return;
+            }
+            if (mainView.indexAt(mainView.contentX, 0) != firstVisible
+                || mainView.indexAt(mainView.contentX + mainView.width - 1, 0) != lastVisible) {
+                updateLoadedPages();
+            }
+        }
     }
 
     Component {
@@ -509,7 +471,7 @@ T.Control {
             id: container
             height: mainView.height
             width: root.width
-            state: page ? (!root.wideMode ? "vertical" : (container.level >= pagesLogic.count - 1 ? "last" : "middle")) : "";
+            state: page || unloaded ? (!root.wideMode ? "vertical" : (container.level >= pagesLogic.count - 1 ? "last" : "middle")) : "";
 
             property int level
 
@@ -518,6 +480,8 @@ T.Control {
 
             property Item page
             property Item owner
+            // the page has been unloaded, the container is just keeping its place
+            property bool unloaded: false
             onPageChanged: {
                 if (page) {
                     owner = page.parent;
@@ -561,7 +525,7 @@ T.Control {
                         width: pagesLogic.roundedDefaultColumnWidth
                     }
                     PropertyChanges {
-                        target: container.page.anchors
+                        target: container.page ? container.page.anchors : null
                         rightMargin: {
                             return -(root.width - pagesLogic.roundedDefaultColumnWidth*2);
                         }
@@ -574,7 +538,7 @@ T.Control {
                         width: pagesLogic.roundedDefaultColumnWidth
                     }
                     PropertyChanges {
-                        target: container.page.anchors
+                        target: container.page ? container.page.anchors : null
                         rightMargin: 0
                     }
                 }
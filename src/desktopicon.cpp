@@ -19,6 +19,10 @@
  */
 
 #include "desktopicon.h"
+#include "iconrasterizer.h"
+#include "imagetexturescache.h"
+#include "maskedtexturenode.h"
+#include "remoteimageloader.h"
 #include "platformtheme.h"
 
 #include <QSGSimpleTextureNode>
@@ -35,6 +39,11 @@
 #include <QGuiApplication>
 #include <QPointer>
 #include <QPainter>
+#include <QFileInfo>
+#include <QImageReader>
+#if QT_VERSION >= QT_VERSION_CHECK(5, 8, 0)
+#include <QSGRendererInterface>
+#endif
 
 class ManagedTextureNode : public QSGSimpleTextureNode
 {
@@ -57,78 +66,24 @@ void ManagedTextureNode::setTexture(QSharedPointer<QSGTexture> texture)
     QSGSimpleTextureNode::setTexture(texture.data());
 }
 
-typedef QHash<qint64, QHash<QWindow*, QWeakPointer<QSGTexture> > > TexturesCache;
-
-struct ImageTexturesCachePrivate
-{
-    TexturesCache cache;
-};
-
-class ImageTexturesCache
-{
-public:
-    ImageTexturesCache();
-    ~ImageTexturesCache();
-
-    /**
-     * @returns the texture for a given @p window and @p image.
-     *
-     * If an @p image id is the same as one already provided before, we won't create
-     * a new texture and return a shared pointer to the existing texture.
-     */
-    QSharedPointer<QSGTexture> loadTexture(QQuickWindow *window, const QImage &image, QQuickWindow::CreateTextureOptions options);
-
-    QSharedPointer<QSGTexture> loadTexture(QQuickWindow *window, const QImage &image);
-
-
-private:
-    QScopedPointer<ImageTexturesCachePrivate> d;
-};
-
-
-ImageTexturesCache::ImageTexturesCache()
-    : d(new ImageTexturesCachePrivate)
+static bool canTintMasks(QQuickWindow *window)
 {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 8, 0)
+    //custom materials are not supported by the software renderer
+    return window && window->rendererInterface()->graphicsApi() == QSGRendererInterface::OpenGL;
+#else
+    return window;
+#endif
 }
 
-ImageTexturesCache::~ImageTexturesCache()
+//a file QImageReader can read by itself, which QIcon would have loaded the very same way
+static bool canReadIconFile(const QString &path)
 {
+    static const QList<QByteArray> formats = QImageReader::supportedImageFormats();
+    const QFileInfo info(path);
+    return formats.contains(info.suffix().toLower().toLatin1()) && info.isFile();
 }
 
-QSharedPointer<QSGTexture> ImageTexturesCache::loadTexture(QQuickWindow *window, const QImage &image, QQuickWindow::CreateTextureOptions options)
-{
-    qint64 id = image.cacheKey();
-    QSharedPointer<QSGTexture> texture = d->cache.value(id).value(window).toStrongRef();
-
-    if (!texture) {
-        auto cleanAndDelete = [this, window, id](QSGTexture* texture) {
-            QHash<QWindow*, QWeakPointer<QSGTexture> >& textures = (d->cache)[id];
-            textures.remove(window);
-            if (textures.isEmpty())
-                d->cache.remove(id);
-            delete texture;
-        };
-        texture = QSharedPointer<QSGTexture>(window->createTextureFromImage(image, options), cleanAndDelete);
-        (d->cache)[id][window] = texture.toWeakRef();
-    }
-
-    //if we have a cache in an atlas but our request cannot use an atlassed texture
-    //create a new texture and use that
-    //don't use removedFromAtlas() as that requires keeping a reference to the non atlased version
-    if (!(options & QQuickWindow::TextureCanUseAtlas) && texture->isAtlasTexture()) {
-        texture = QSharedPointer<QSGTexture>(window->createTextureFromImage(image, options));
-    }
-
-    return texture;
-}
-
-QSharedPointer<QSGTexture> ImageTexturesCache::loadTexture(QQuickWindow *window, const QImage &image)
-{
-    return loadTexture(window, image, 0);
-}
-
-Q_GLOBAL_STATIC(ImageTexturesCache, s_iconImageCache)
-
 DesktopIcon::DesktopIcon(QQuickItem *parent)
     : QQuickItem(parent),
       m_smooth(false),
@@ -141,7 +96,7 @@ DesktopIcon::DesktopIcon(QQuickItem *parent)
     //FIXME: not necessary anymore
     connect(qApp, &QGuiApplication::paletteChanged, this, [this]() {
         m_changed = true;
-        update();
+        polish();
     });
 }
 
@@ -156,20 +111,42 @@ void DesktopIcon::setSource(const QVariant &icon)
         return;
     }
     m_source = icon;
+    m_loadedImage = QImage();
+    m_loadedSize = QSize();
+    m_failedSize = QSize();
+    m_loadFailed = false;
+    m_loading = false;
+    m_textureFactory.reset();
+    if (m_pendingResponse) {
+        m_pendingResponse->cancel();
+        m_pendingResponse = Q_NULLPTR;
+    }
     m_changed = true;
 
+    polish();
+    emit sourceChanged();
+}
+
+Kirigami::PlatformTheme *DesktopIcon::theme()
+{
+    //images and plain colors never need it, don't create a theme for every thumbnail
     if (!m_theme) {
         m_theme = static_cast<Kirigami::PlatformTheme *>(qmlAttachedPropertiesObject<Kirigami::PlatformTheme>(this, true));
         Q_ASSERT(m_theme);
 
         connect(m_theme, &Kirigami::PlatformTheme::colorsChanged, this, [this]() {
+            //masks are tinted by the GPU, there is no need to rasterize them again
+            if (m_maskColor.isValid()) {
+                m_maskColor = m_theme->textColor();
+                update();
+                return;
+            }
             m_changed = true;
-            update();
+            polish();
         });
     }
 
-    update();
-    emit sourceChanged();
+    return m_theme;
 }
 
 QVariant DesktopIcon::source() const
@@ -184,7 +161,7 @@ void DesktopIcon::setEnabled(const bool enabled)
     }
     QQuickItem::setEnabled(enabled);
     m_changed = true;
-    update();
+    polish();
     emit enabledChanged();
 }
 
@@ -196,7 +173,7 @@ void DesktopIcon::setActive(const bool active)
     }
     m_active = active;
     m_changed = true;
-    update();
+    polish();
     emit activeChanged();
 }
 
@@ -217,7 +194,7 @@ void DesktopIcon::setSelected(const bool selected)
     }
     m_selected = selected;
     m_changed = true;
-    update();
+    polish();
     emit selectedChanged();
 }
 
@@ -274,7 +251,7 @@ void DesktopIcon::setSmooth(const bool smooth)
     }
     m_smooth = smooth;
     m_changed = true;
-    update();
+    polish();
     emit smoothChanged();
 }
 
@@ -290,123 +267,184 @@ QSGNode* DesktopIcon::updatePaintNode(QSGNode* node, QQuickItem::UpdatePaintNode
         return Q_NULLPTR;
     }
 
-    if (m_changed || node == 0) {
-        QImage img;
-        const QSize itemSize(width(), height());
-
-        if (itemSize.width() != 0 && itemSize.height() != 0) {
-            const QSize size = itemSize * (window() ? window()->devicePixelRatio() : qApp->devicePixelRatio());
-
-            switch(m_source.type()){
-            case QVariant::Pixmap:
-                img = m_source.value<QPixmap>().toImage();
-                break;
-            case QVariant::Image:
-                img = m_source.value<QImage>();
-                break;
-            case QVariant::Bitmap:
-                img = m_source.value<QBitmap>().toImage();
-                break;
-            case QVariant::Icon:
-                img = m_source.value<QIcon>().pixmap(size, iconMode(), QIcon::On).toImage();
-                break;
-            case QVariant::Url:
-            case QVariant::String:
-                img = findIcon(size);
-                break;
-            case QVariant::Brush:
-                //todo: fill here too?
-            case QVariant::Color:
-                img = QImage(size, QImage::Format_Alpha8);
-                img.fill(m_source.value<QColor>());
-                break;
-            default:
-                break;
-            }
+    const bool masked = m_maskColor.isValid() && !m_textureFactory;
+    ManagedTextureNode* mNode = masked ? Q_NULLPTR : dynamic_cast<ManagedTextureNode*>(node);
+    MaskedTextureNode* maskNode = masked ? dynamic_cast<MaskedTextureNode*>(node) : Q_NULLPTR;
+
+    if (m_imageChanged || (!mNode && !maskNode)) {
+        m_imageChanged = false;
 
-            if (img.isNull()){
-                img = QImage(size, QImage::Format_Alpha8);
-                img.fill(Qt::transparent);
+        QSharedPointer<QSGTexture> texture;
+        if (m_textureFactory) {
+            texture = QSharedPointer<QSGTexture>(m_textureFactory->createTexture(window()));
+        } else if (!m_image.isNull()) {
+            texture = ImageTexturesCache::self()->loadTexture(window(), m_image);
+        }
+
+        if (!texture) {
+            //nothing rasterized yet, or the icon has an empty size
+            delete node;
+            return Q_NULLPTR;
+        }
+        if (masked) {
+            if (!maskNode) {
+                delete node;
+                maskNode = new MaskedTextureNode;
             }
-            if (img.size() != size){
-                img = img.scaled(size, Qt::KeepAspectRatioByExpanding, m_smooth ? Qt::SmoothTransformation : Qt::FastTransformation );
+            maskNode->setTexture(texture);
+        } else {
+            if (!mNode) {
+                delete node;
+                mNode = new ManagedTextureNode;
             }
+            mNode->setTexture(texture);
         }
-        m_changed = false;
+    }
 
-        ManagedTextureNode* mNode = dynamic_cast<ManagedTextureNode*>(node);
-        if (!mNode) {
-            delete node;
-            mNode = new ManagedTextureNode;
+    //while a new image is being rasterized, the old texture gets stretched on the new geometry
+    const QRectF rect(QPoint(0,0), QSize(width(), height()));
+    //rasterized at a bucket size, or not yet at the new one: nearest filtering would drop or double whole rows
+    const qreal dpr = window()->devicePixelRatio();
+    const QSize pixelSize(qRound(width() * dpr), qRound(height() * dpr));
+    const QSize textureSize = m_textureFactory ? m_textureFactory->textureSize() : m_image.size();
+    const QSGTexture::Filtering filtering = m_smooth || textureSize != pixelSize ? QSGTexture::Linear : QSGTexture::Nearest;
+    if (maskNode) {
+        maskNode->setColor(m_maskColor);
+        maskNode->setFiltering(filtering);
+        maskNode->setRect(rect);
+        return maskNode;
+    }
+
+    mNode->setFiltering(filtering);
+    mNode->setRect(rect);
+
+    return mNode;
+}
+
+void DesktopIcon::updatePolish()
+{
+    QQuickItem::updatePolish();
+
+    //one job at a time: if something changes while rasterizing, we'll get there once it's done
+    if (!m_changed || m_rasterizing) {
+        return;
+    }
+    m_changed = false;
+
+    IconRasterRequest request;
+    const QSize itemSize(width(), height());
+
+    if (!m_source.isNull() && itemSize.width() != 0 && itemSize.height() != 0) {
+        request.devicePixelRatio = window() ? window()->devicePixelRatio() : qApp->devicePixelRatio();
+        //sources are asked for the bucket size, the texture gets scaled to the item by the GPU
+        request.size = IconRasterizer::bucketSize(itemSize * request.devicePixelRatio);
+        request.mode = iconMode();
+        request.smooth = m_smooth;
+
+        switch(m_source.type()){
+        case QVariant::Pixmap: {
+            const QPixmap pixmap = m_source.value<QPixmap>();
+            request.image = pixmap.toImage();
+            request.sourceId = QStringLiteral("pixmap:") + QString::number(pixmap.cacheKey());
+            break;
         }
-        mNode->setTexture(s_iconImageCache->loadTexture(window(), img));
-        mNode->setRect(QRect(QPoint(0,0), itemSize));
-        node = mNode;
+        case QVariant::Image:
+            request.image = m_source.value<QImage>();
+            request.sourceId = QStringLiteral("image:") + QString::number(request.image.cacheKey());
+            break;
+        case QVariant::Bitmap: {
+            const QBitmap bitmap = m_source.value<QBitmap>();
+            request.image = bitmap.toImage();
+            request.sourceId = QStringLiteral("pixmap:") + QString::number(bitmap.cacheKey());
+            break;
+        }
+        case QVariant::Icon:
+            request.icon = m_source.value<QIcon>();
+            request.sourceId = QStringLiteral("icon:") + QString::number(request.icon.cacheKey());
+            break;
+        case QVariant::Url:
+        case QVariant::String:
+            if (!findIcon(request)) {
+                //provided as a texture, or nothing to show yet
+                m_maskColor = QColor();
+                if (!m_image.isNull()) {
+                    m_image = QImage();
+                    m_imageChanged = true;
+                    update();
+                }
+                return;
+            }
+            break;
+        case QVariant::Brush:
+            //todo: fill here too?
+        case QVariant::Color:
+            request.fillColor = m_source.value<QColor>();
+            request.sourceId = QStringLiteral("color:") + request.fillColor.name(QColor::HexArgb);
+            break;
+        default:
+            break;
+        }
+    }
+
+    if (!request.size.isValid() || request.size.isEmpty()) {
+        setImage(QImage());
+        return;
+    }
+
+    //keep only the alpha of masks, the color is applied when drawing them
+    const bool masked = request.maskColor.isValid() && canTintMasks(window());
+    if (masked) {
+        request.maskColor = QColor();
+        request.alphaMask = true;
+    }
+
+    //an identical icon has been already rasterized, just share its image and texture
+    const QImage cached = IconRasterizer::self()->cachedImage(request.cacheKey());
+    if (!cached.isNull()) {
+        setImage(cached, masked);
+        return;
     }
 
-    return node;
+    m_rasterizing = true;
+    IconRasterizer::self()->rasterize(this, request, [this, masked](const QImage &image) {
+        m_rasterizing = false;
+        setImage(image, masked);
+        if (m_changed) {
+            polish();
+        }
+    });
+}
+
+void DesktopIcon::setImage(const QImage &image, bool masked)
+{
+    m_image = image;
+    m_maskColor = masked ? theme()->textColor() : QColor();
+    m_textureFactory.reset();
+    m_imageChanged = true;
+    update();
 }
 
 void DesktopIcon::geometryChanged(const QRectF &newGeometry, const QRectF &oldGeometry)
 {
     if (newGeometry.size() != oldGeometry.size()) {
         m_changed = true;
-        update();
+        polish();
     }
     QQuickItem::geometryChanged(newGeometry, oldGeometry);
 }
 
-void DesktopIcon::handleFinished(QNetworkAccessManager* qnam, QNetworkReply* reply) {
-    if (reply->error() == QNetworkReply::NoError) {
-        const QUrl possibleRedirectUrl = reply->attribute(QNetworkRequest::RedirectionTargetAttribute).toUrl();
-        if (!possibleRedirectUrl.isEmpty()) {
-            const QUrl redirectUrl = reply->url().resolved(possibleRedirectUrl);
-            if (redirectUrl == reply->url()) {
-                // no infinite redirections thank you very much
-                reply->deleteLater();
-                return;
-            }
-            reply->deleteLater();
-            QNetworkRequest request(possibleRedirectUrl);
-            request.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::PreferCache);
-            QNetworkReply* newReply = qnam->get(request);
-            connect(newReply, &QNetworkReply::readyRead, this, [this, newReply](){ handleReadyRead(newReply); });
-            connect(newReply, &QNetworkReply::finished, this, [this, qnam, newReply](){ handleFinished(qnam, newReply); });
-            return;
-        }
-    }
-}
-
-void DesktopIcon::handleReadyRead(QNetworkReply* reply)
+void DesktopIcon::itemChange(ItemChange change, const ItemChangeData &value)
 {
-    if (reply->attribute(QNetworkRequest::RedirectionTargetAttribute).isNull()) {
-        // We're handing the event loop back while doing network work, and it turns out
-        // this fairly regularly results in things being deleted under us. So, just
-        // handle that and crash less :)
-        QPointer<DesktopIcon> me(this);
-        QByteArray data;
-        do {
-            data.append(reply->read(32768));
-            // Because we are in the main thread, this could be potentially very expensive, so let's not block
-            qApp->processEvents();
-            if(!me) {
-                return;
-            }
-        } while(!reply->atEnd());
-        m_loadedImage = QImage::fromData(data);
-        if (m_loadedImage.isNull()) {
-            // broken image from data, inform the user of this with some useful broken-image thing...
-            const QSize size = QSize(width(), height()) * (window() ? window()->devicePixelRatio() : qApp->devicePixelRatio());
-            m_loadedImage = QIcon::fromTheme("unknown").pixmap(size, iconMode(), QIcon::On).toImage();
-        }
+    if (change == ItemDevicePixelRatioHasChanged) {
         m_changed = true;
-        update();
+        polish();
     }
+    QQuickItem::itemChange(change, value);
 }
 
-QImage DesktopIcon::findIcon(const QSize &size)
+bool DesktopIcon::findIcon(IconRasterRequest &request)
 {
-    QImage img;
+    const QSize &size = request.size;
     QString iconSource = m_source.toString();
     if (iconSource.startsWith("image://")){
         QUrl iconUrl(iconSource);
@@ -416,54 +454,171 @@ QImage DesktopIcon::findIcon(const QSize &size)
         QQuickImageProvider* imageProvider = dynamic_cast<QQuickImageProvider*>(
                     qmlEngine(this)->imageProvider(iconProviderId));
         if (!imageProvider)
-            return img;
+            return true;
+        request.sourceId = iconSource;
         switch(imageProvider->imageType()){
         case QQmlImageProviderBase::Image:
-            img = imageProvider->requestImage(iconId, &actualSize, size);
+            request.image = imageProvider->requestImage(iconId, &actualSize, size);
             break;
         case QQmlImageProviderBase::Pixmap:
-            img = imageProvider->requestPixmap(iconId, &actualSize, size).toImage();
+            request.image = imageProvider->requestPixmap(iconId, &actualSize, size).toImage();
             break;
         case QQmlImageProviderBase::Texture:
+            //the texture will be created straight away in the render thread
+            if (!m_textureFactory || m_loadedSize != size) {
+                setTextureFactory(imageProvider->requestTexture(iconId, &actualSize, size), size);
+            }
+            return false;
+        case QQmlImageProviderBase::ImageResponse: {
+            QQuickAsyncImageProvider *asyncProvider = static_cast<QQuickAsyncImageProvider *>(imageProvider);
+            if (m_loadedSize != size && m_failedSize != size) {
+                //keep showing what we have until the response for the new size arrives
+                requestImageResponse(asyncProvider, iconId, size);
+            }
+            if (!m_loadedImage.isNull()) {
+                request.image = m_loadedImage;
+                if (m_loadedSize != size) {
+                    request.sourceId.clear();
+                }
+            } else if (m_textureFactory) {
+                return false;
+            } else if (m_loadFailed) {
+                request.icon = QIcon::fromTheme("unknown");
+            } else {
+                //nothing to show yet
+                return false;
+            }
+            break;
+        }
         case QQmlImageProviderBase::Invalid:
-        case QQmlImageProviderBase::ImageResponse:
-            //will have to investigate this more
             break;
         }
     } else if(iconSource.startsWith("http://") || iconSource.startsWith("https://")) {
+        const QUrl url = m_source.toUrl();
+        const QImage cached = RemoteImageLoader::self()->cachedImage(url, size);
+        if (!cached.isNull()) {
+            m_loadedImage = cached;
+            m_loadedSize = size;
+        }
         if(!m_loadedImage.isNull()) {
-            return m_loadedImage.scaled(size, Qt::KeepAspectRatio, m_smooth ? Qt::SmoothTransformation : Qt::FastTransformation );
+            request.image = m_loadedImage;
+            if (m_loadedSize == size) {
+                request.sourceId = iconSource;
+            } else if (m_failedSize != size) {
+                //show the image decoded for the old size until the new one is there
+                loadRemoteImage(url, size);
+            }
+            return true;
         }
-        QQmlEngine* engine = qmlEngine(this);
-        QNetworkAccessManager* qnam;
-        if (engine && (qnam = qmlEngine(this)->networkAccessManager())) {
-            QNetworkRequest request(m_source.toUrl());
-            request.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::PreferCache);
-            QNetworkReply* reply = qnam->get(request);
-            connect(reply, &QNetworkReply::readyRead, this, [this, reply](){ handleReadyRead(reply); });
-            connect(reply, &QNetworkReply::finished, this, [this, qnam, reply](){ handleFinished(qnam, reply); });
+        if (m_loadFailed && m_failedSize == size) {
+            // broken image from data, inform the user of this with some useful broken-image thing...
+            request.icon = QIcon::fromTheme("unknown");
+            return true;
         }
+        loadRemoteImage(url, size);
         // Temporary icon while we wait for the real image to load...
-        img = QIcon::fromTheme("image-x-icon").pixmap(size, iconMode(), QIcon::On).toImage();
+        request.icon = QIcon::fromTheme("image-x-icon");
     } else {
         if (iconSource.startsWith("qrc:/")){
             iconSource = iconSource.mid(3);
         }
         QIcon icon(iconSource);
         if (icon.availableSizes().isEmpty()) {
-            icon = m_theme->iconFromTheme(iconSource, m_color);
+            icon = theme()->iconFromTheme(iconSource, m_color);
+            request.persistable = true;
         }
         if (!icon.availableSizes().isEmpty()){
-            img = icon.pixmap(size, iconMode(), QIcon::On).toImage();
+            request.icon = icon;
+            if (!request.persistable && request.mode == QIcon::Normal && canReadIconFile(iconSource)) {
+                //a plain file, decoded or rendered in the icon thread pool
+                request.filePath = iconSource;
+            }
+            //the custom color may have been used by the platform theme to colorize the icon
+            request.sourceId = m_color == Qt::transparent ? iconSource : iconSource + QLatin1Char('#') + m_color.name(QColor::HexArgb);
             if (m_isMask || icon.isMask()) {
-                QPainter p(&img);
-                p.setCompositionMode(QPainter::CompositionMode_SourceIn);
-                p.fillRect(img.rect(), m_theme->textColor());
-                p.end();
+                request.maskColor = theme()->textColor();
             }
         }
     }
-    return img;
+    return true;
+}
+
+void DesktopIcon::loadRemoteImage(const QUrl &url, const QSize &size)
+{
+    QQmlEngine* engine = qmlEngine(this);
+    QNetworkAccessManager* qnam;
+    if (m_loading || !engine || !(qnam = engine->networkAccessManager())) {
+        return;
+    }
+
+    m_loading = true;
+    RemoteImageLoader::self()->load(qnam, url, size, this, [this, url, size](const QImage &image) {
+        //the source changed in the meantime
+        if (!m_loading || m_source.toUrl() != url) {
+            return;
+        }
+        m_loading = false;
+        if (!image.isNull()) {
+            m_loadedImage = image;
+            m_loadedSize = size;
+        } else {
+            m_failedSize = size;
+            m_loadFailed = m_loadedImage.isNull();
+        }
+        m_changed = true;
+        polish();
+    });
+}
+
+void DesktopIcon::requestImageResponse(QQuickAsyncImageProvider *provider, const QString &id, const QSize &size)
+{
+    if (m_pendingResponse) {
+        return;
+    }
+
+    QQuickImageResponse *response = provider->requestImageResponse(id, size);
+    if (!response) {
+        return;
+    }
+    m_pendingResponse = response;
+
+    //finished can be emitted from any thread
+    connect(response, &QQuickImageResponse::finished, response, &QObject::deleteLater);
+    connect(response, &QQuickImageResponse::finished, this, [this, response, size]() {
+        //the source changed in the meantime
+        if (m_pendingResponse != response) {
+            return;
+        }
+        m_pendingResponse = Q_NULLPTR;
+
+        QQuickTextureFactory *factory = response->errorString().isEmpty() ? response->textureFactory() : Q_NULLPTR;
+        const QImage image = factory ? factory->image() : QImage();
+        if (!image.isNull()) {
+            //image based factory: it can go trough the usual masking, scaling and caching
+            delete factory;
+            m_loadedImage = image;
+            m_loadedSize = size;
+            m_textureFactory.reset();
+        } else if (factory) {
+            m_loadedImage = QImage();
+            setTextureFactory(factory, size);
+        } else {
+            //don't ask again for this size, a new source or size will
+            m_failedSize = size;
+            m_loadFailed = m_loadedImage.isNull() && !m_textureFactory;
+        }
+        m_changed = true;
+        polish();
+    }, Qt::QueuedConnection);
+}
+
+void DesktopIcon::setTextureFactory(QQuickTextureFactory *factory, const QSize &size)
+{
+    m_textureFactory.reset(factory);
+    m_loadedSize = size;
+    m_maskColor = QColor();
+    m_imageChanged = true;
+    update();
 }
 
 QIcon::Mode DesktopIcon::iconMode() const
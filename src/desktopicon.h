@@ -22,11 +22,15 @@
 #define QICONITEM_H
 
 #include <QIcon>
+#include <QPointer>
 #include <QQuickItem>
+#include <QSharedPointer>
 #include <QVariant>
 
-class QNetworkAccessManager;
-class QNetworkReply;
+class QQuickAsyncImageProvider;
+class QQuickImageResponse;
+class QQuickTextureFactory;
+struct IconRasterRequest;
 
 namespace Kirigami {
     class PlatformTheme;
@@ -90,10 +94,21 @@ Q_SIGNALS:
 
 protected:
     void geometryChanged(const QRectF &newGeometry, const QRectF &oldGeometry) Q_DECL_OVERRIDE;
-    QImage findIcon(const QSize& size);
-    void handleFinished(QNetworkAccessManager* qnam, QNetworkReply* reply);
-    void handleReadyRead(QNetworkReply* reply);
+    void itemChange(ItemChange change, const ItemChangeData &value) Q_DECL_OVERRIDE;
+    void updatePolish() Q_DECL_OVERRIDE;
+    /**
+     * Fills @p request with what's needed to rasterize the icon.
+     * @returns false if there is nothing to rasterize, as the icon comes
+     * from a texture factory or isn't available yet.
+     */
+    bool findIcon(IconRasterRequest &request);
+    void loadRemoteImage(const QUrl &url, const QSize &size);
+    void requestImageResponse(QQuickAsyncImageProvider *provider, const QString &id, const QSize &size);
+    void setTextureFactory(QQuickTextureFactory *factory, const QSize &size);
+    void setImage(const QImage &image, bool masked = false);
     QIcon::Mode iconMode() const;
+    //created on first use
+    Kirigami::PlatformTheme *theme();
 
 private:
     Kirigami::PlatformTheme *m_theme = nullptr;
@@ -103,7 +118,24 @@ private:
     bool m_active;
     bool m_selected;
     bool m_isMask;
+    //an image is being rasterized in the thread pool
+    bool m_rasterizing = false;
+    //m_image has to be uploaded in a new texture
+    bool m_imageChanged = false;
+    //the remote image is being downloaded
+    bool m_loading = false;
+    bool m_loadFailed = false;
+    //the size the last remote or asynchronous load failed for, not to be asked again
+    QSize m_failedSize;
+    //the remote or asynchronously provided image, as loaded for m_loadedSize
     QImage m_loadedImage;
+    QSize m_loadedSize;
+    //from texture providers, or image responses not backed by a QImage
+    QSharedPointer<QQuickTextureFactory> m_textureFactory;
+    QPointer<QQuickImageResponse> m_pendingResponse;
+    QImage m_image;
+    //valid if m_image is an alpha mask, to be filled with this color
+    QColor m_maskColor;
     QColor m_color = Qt::transparent;
 };
 
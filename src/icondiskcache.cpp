@@ -0,0 +1,306 @@
+/*
+ *   Copyright 2017 Marco Martin <mart@kde.org>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Library General Public License as
+ *   published by the Free Software Foundation; either version 2, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details
+ *
+ *   You should have received a copy of the GNU Library General Public
+ *   License along with this program; if not, write to the
+ *   Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "icondiskcache.h"
+#include "iconrasterizer.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QIcon>
+#include <QSaveFile>
+#include <QSettings>
+#include <QStandardPaths>
+#include <QUrl>
+
+#include <cstring>
+
+namespace {
+
+const quint32 s_magic = 0x4B494943; // "KIIC"
+const quint32 s_version = 2;
+//how often, in msecs, the icon theme is checked for modifications
+const qint64 s_themeCheckInterval = 5000;
+
+//fixed size header, followed by the raw image data, bytesPerLine * height bytes
+struct IconFileHeader
+{
+    quint32 magic;
+    quint32 version;
+    qint32 width;
+    qint32 height;
+    qint32 bytesPerLine;
+    qint32 format;
+    //in msecs since the epoch, 0 for never
+    qint64 expires;
+};
+
+bool isSupportedFormat(QImage::Format format)
+{
+    return format == QImage::Format_ARGB32_Premultiplied || format == QImage::Format_ARGB32
+        || format == QImage::Format_RGB32 || format == QImage::Format_Alpha8;
+}
+
+void unmapIconFile(void *file)
+{
+    //destroying the QFile unmaps the memory
+    delete static_cast<QFile *>(file);
+}
+
+}
+
+Q_GLOBAL_STATIC(IconDiskCache, s_iconDiskCache)
+
+IconDiskCache::IconDiskCache()
+{
+    const QString env = QString::fromLatin1(qgetenv("KIRIGAMI_ICON_DISK_CACHE"));
+    m_enabled = (env == QStringLiteral("1") || env == QStringLiteral("true"))
+        && !QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation).isEmpty();
+}
+
+IconDiskCache::~IconDiskCache()
+{
+}
+
+IconDiskCache *IconDiskCache::self()
+{
+    return s_iconDiskCache;
+}
+
+bool IconDiskCache::isEnabled() const
+{
+    return m_enabled;
+}
+
+void IconDiskCache::checkTheme()
+{
+    if (!m_enabled) {
+        return;
+    }
+    m_themeChecked.invalidate();
+    updateThemeDirectory();
+}
+
+void IconDiskCache::updateThemeDirectory()
+{
+    const QString themeName = QIcon::themeName();
+    if (!m_directory.isEmpty() && themeName == m_themeName
+        && m_themeChecked.isValid() && m_themeChecked.elapsed() < s_themeCheckInterval) {
+        return;
+    }
+    m_themeName = themeName;
+    m_themeChecked.start();
+
+    //any change in the installation of the theme or of the ones it inherits from
+    //invalidates the whole cache of that theme: installing or removing an icon
+    //changes the modification time of the directory it's in
+    QCryptographicHash stamp(QCryptographicHash::Sha1);
+    QStringList themes = {themeName};
+    for (int i = 0; i < themes.count(); ++i) {
+        for (const QString &path : QIcon::themeSearchPaths()) {
+            const QDir themeDir(path + QLatin1Char('/') + themes.at(i));
+            const QFileInfo index(themeDir.filePath(QStringLiteral("index.theme")));
+            if (!index.exists()) {
+                continue;
+            }
+            QStringList directories = {QStringLiteral("."), QStringLiteral("index.theme")};
+            QSettings settings(index.absoluteFilePath(), QSettings::IniFormat);
+            settings.beginGroup(QStringLiteral("Icon Theme"));
+            directories << settings.value(QStringLiteral("Directories")).toStringList()
+                        << settings.value(QStringLiteral("ScaledDirectories")).toStringList();
+            for (const QString &parent : settings.value(QStringLiteral("Inherits")).toStringList()) {
+                if (!parent.isEmpty() && !themes.contains(parent)) {
+                    themes << parent;
+                }
+            }
+
+            for (const QString &directory : directories) {
+                const QFileInfo info(themeDir.filePath(directory));
+                if (info.exists()) {
+                    stamp.addData(info.absoluteFilePath().toUtf8());
+                    stamp.addData(QByteArray::number(info.lastModified().toMSecsSinceEpoch()));
+                }
+            }
+        }
+        if (i == themes.count() - 1 && !themes.contains(QStringLiteral("hicolor"))) {
+            //the fallback of every theme
+            themes << QStringLiteral("hicolor");
+        }
+    }
+    const QByteArray stampHex = stamp.result().toHex();
+
+    QDir dir(QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation)
+             + QStringLiteral("/kirigami/icons/") + (themeName.isEmpty() ? QStringLiteral("default") : themeName));
+
+    bool valid = false;
+    QFile stampFile(dir.filePath(QStringLiteral("stamp")));
+    if (stampFile.open(QIODevice::ReadOnly)) {
+        valid = stampFile.readAll() == stampHex;
+        stampFile.close();
+    }
+
+    if (!valid) {
+        dir.removeRecursively();
+        dir.mkpath(QStringLiteral("."));
+        QSaveFile newStamp(dir.filePath(QStringLiteral("stamp")));
+        if (newStamp.open(QIODevice::WriteOnly)) {
+            newStamp.write(stampHex);
+            newStamp.commit();
+        }
+    }
+
+    m_directory = dir.absolutePath();
+}
+
+QString IconDiskCache::filePath(const IconCacheKey &key)
+{
+    if (!m_enabled || !key.isValid()) {
+        return QString();
+    }
+
+    updateThemeDirectory();
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(key.source.toUtf8());
+    hash.addData(QByteArray::number(key.size.width()) + 'x' + QByteArray::number(key.size.height()));
+    hash.addData(QByteArray::number(int(key.mode)) + '-' + QByteArray::number(key.tint)
+                 + '-' + QByteArray::number(key.devicePixelRatio) + '-' + QByteArray::number(int(key.smooth)) + '-' + QByteArray::number(int(key.alphaMask)));
+
+    return m_directory + QLatin1Char('/') + QString::fromLatin1(hash.result().toHex());
+}
+
+QString IconDiskCache::remoteFilePath(const QUrl &url, const QSize &size)
+{
+    if (!m_enabled || url.isEmpty()) {
+        return QString();
+    }
+
+    if (m_remoteDirectory.isEmpty()) {
+        QDir dir(QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + QStringLiteral("/kirigami/remote"));
+        dir.mkpath(QStringLiteral("."));
+        m_remoteDirectory = dir.absolutePath();
+    }
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(url.toEncoded());
+    hash.addData(QByteArray::number(size.width()) + 'x' + QByteArray::number(size.height()));
+
+    return m_remoteDirectory + QLatin1Char('/') + QString::fromLatin1(hash.result().toHex());
+}
+
+QImage IconDiskCache::load(const QString &path, qint64 *expires)
+{
+    QFile *file = new QFile(path);
+    if (!file->open(QIODevice::ReadOnly) || file->size() < qint64(sizeof(IconFileHeader))) {
+        delete file;
+        return QImage();
+    }
+
+    uchar *data = file->map(0, file->size());
+    //the mapping stays valid until the QFile gets destroyed
+    file->close();
+    if (!data) {
+        delete file;
+        return QImage();
+    }
+
+    IconFileHeader header;
+    memcpy(&header, data, sizeof(IconFileHeader));
+    const QImage::Format format = QImage::Format(header.format);
+
+    if (header.magic != s_magic || header.version != s_version || !isSupportedFormat(format)
+        || header.width <= 0 || header.height <= 0
+        || header.bytesPerLine < header.width * (format == QImage::Format_Alpha8 ? 1 : 4)
+        || file->size() != qint64(sizeof(IconFileHeader)) + qint64(header.bytesPerLine) * header.height) {
+        delete file;
+        QFile::remove(path);
+        return QImage();
+    }
+
+    if (expires) {
+        *expires = header.expires;
+    }
+
+    //the image can be released in any thread, so the file can't be bound to this one
+    file->moveToThread(nullptr);
+
+    return QImage(static_cast<const uchar *>(data + sizeof(IconFileHeader)), header.width, header.height,
+                  header.bytesPerLine, format, unmapIconFile, file);
+}
+
+void IconDiskCache::save(const QString &path, const QImage &image, qint64 expires)
+{
+    if (image.isNull()) {
+        return;
+    }
+
+    QImage img = image;
+    if (!isSupportedFormat(img.format())) {
+        img = img.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    }
+
+    IconFileHeader header;
+    memset(&header, 0, sizeof(IconFileHeader));
+    header.magic = s_magic;
+    header.version = s_version;
+    header.width = img.width();
+    header.height = img.height();
+    header.bytesPerLine = img.bytesPerLine();
+    header.format = img.format();
+    header.expires = expires;
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return;
+    }
+    file.write(reinterpret_cast<const char *>(&header), sizeof(IconFileHeader));
+    file.write(reinterpret_cast<const char *>(img.constBits()), qint64(img.bytesPerLine()) * img.height());
+    file.commit();
+}
+
+void IconDiskCache::markUsed(const QString &path)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
+    QFile file(path);
+    if (file.open(QIODevice::ReadWrite)) {
+        file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+    }
+#else
+    //without a way to touch the file, prune() removes the oldest written ones first
+    Q_UNUSED(path)
+#endif
+}
+
+void IconDiskCache::prune(const QString &directory, qint64 maxBytes)
+{
+    //most recently used first; the files being written by QSaveFile have a suffix, leave them alone
+    const QFileInfoList files = QDir(directory).entryInfoList(QDir::Files | QDir::NoDotAndDotDot, QDir::Time);
+    qint64 bytes = 0;
+    for (const QFileInfo &info : files) {
+        if (!info.suffix().isEmpty()) {
+            continue;
+        }
+        bytes += info.size();
+        if (bytes > maxBytes) {
+            QFile::remove(info.absoluteFilePath());
+        }
+    }
+}
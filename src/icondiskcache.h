@@ -0,0 +1,115 @@
+/*
+ *   Copyright 2017 Marco Martin <mart@kde.org>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Library General Public License as
+ *   published by the Free Software Foundation; either version 2, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details
+ *
+ *   You should have received a copy of the GNU Library General Public
+ *   License along with this program; if not, write to the
+ *   Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef ICONDISKCACHE_H
+#define ICONDISKCACHE_H
+
+#include <QElapsedTimer>
+#include <QImage>
+#include <QString>
+
+class QUrl;
+
+struct IconCacheKey;
+
+/**
+ * Optional persistent cache of rasterized theme icons, shared between
+ * all the Kirigami applications of the user.
+ *
+ * Every icon is stored uncompressed in its own file, so it can be memory
+ * mapped and used directly as the data of a QImage without any decoding.
+ * The cache is kept per icon theme, and is thrown away when the theme
+ * itself is modified: this is checked again every few seconds, so an
+ * installed or updated theme is picked up without restarting.
+ * Remote images decoded by RemoteImageLoader are stored as well, out of
+ * the theme directories.
+ *
+ * It's enabled by setting the environment variable KIRIGAMI_ICON_DISK_CACHE to 1.
+ */
+class IconDiskCache
+{
+public:
+    IconDiskCache();
+    ~IconDiskCache();
+
+    static IconDiskCache *self();
+
+    bool isEnabled() const;
+
+    /**
+     * @returns the path of the file caching the icon identified by @p key,
+     * for the current icon theme, or an empty string if the cache is disabled.
+     * To be called from the GUI thread.
+     */
+    QString filePath(const IconCacheKey &key);
+
+    /**
+     * Checks right away whether the current icon theme has been modified,
+     * instead of at the next periodic check.
+     * To be called from the GUI thread.
+     */
+    void checkTheme();
+
+    /**
+     * @returns the path of the file caching the image at @p url decoded
+     * for @p size, or an empty string if the cache is disabled.
+     * To be called from the GUI thread.
+     */
+    QString remoteFilePath(const QUrl &url, const QSize &size);
+
+    /**
+     * Maps the file at @p path, the image will use the mapped memory as is.
+     * If @p expires is given, it's set to when the image stops being valid,
+     * in milliseconds since the epoch, 0 if it never does.
+     * @returns a null image if there is no valid cache file at @p path.
+     * Safe to call from any thread.
+     */
+    static QImage load(const QString &path, qint64 *expires = Q_NULLPTR);
+
+    /**
+     * Atomically writes @p image in the file at @p path, to be valid
+     * until @p expires, in milliseconds since the epoch, or forever if 0.
+     * Safe to call from any thread.
+     */
+    static void save(const QString &path, const QImage &image, qint64 expires = 0);
+
+    /**
+     * Records that the file at @p path has just been used, for prune().
+     * Safe to call from any thread.
+     */
+    static void markUsed(const QString &path);
+
+    /**
+     * Removes the least recently used files of @p directory, until they
+     * take less than @p maxBytes.
+     * Safe to call from any thread, but only from one at a time.
+     */
+    static void prune(const QString &directory, qint64 maxBytes);
+
+private:
+    void updateThemeDirectory();
+
+    bool m_enabled;
+    QElapsedTimer m_themeChecked;
+    QString m_themeName;
+    QString m_directory;
+    QString m_remoteDirectory;
+};
+
+#endif
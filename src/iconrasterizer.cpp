@@ -0,0 +1,261 @@
+/*
+ *   Copyright 2017 Marco Martin <mart@kde.org>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Library General Public License as
+ *   published by the Free Software Foundation; either version 2, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details
+ *
+ *   You should have received a copy of the GNU Library General Public
+ *   License along with this program; if not, write to the
+ *   Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "iconrasterizer.h"
+#include "icondiskcache.h"
+
+#include <QGuiApplication>
+#include <QImageReader>
+#include <QPainter>
+#include <QPixmap>
+#include <QRunnable>
+#include <QThread>
+
+class IconRasterJob : public QRunnable
+{
+public:
+    IconRasterJob(IconRasterizer *rasterizer, quint64 id, const IconRasterRequest &request)
+        : m_rasterizer(rasterizer),
+          m_id(id),
+          m_request(request)
+    {}
+
+    void setDiskCachePath(const QString &path)
+    {
+        m_request.diskCachePath = path;
+    }
+
+    void run() Q_DECL_OVERRIDE
+    {
+        const QImage image = IconRasterizer::rasterizeImage(m_request);
+        if (!m_request.diskCachePath.isEmpty()) {
+            IconDiskCache::save(m_request.diskCachePath, image);
+        }
+
+        //the rasterizer is a global static, it outlives the pool and all its jobs
+        emit m_rasterizer->rasterized(m_id, image);
+    }
+
+private:
+    IconRasterizer *m_rasterizer;
+    quint64 m_id;
+    IconRasterRequest m_request;
+};
+
+Q_GLOBAL_STATIC(IconRasterizer, s_iconRasterizer)
+
+IconCacheKey IconRasterRequest::cacheKey() const
+{
+    IconCacheKey key;
+    if (sourceId.isEmpty()) {
+        return key;
+    }
+    key.source = sourceId;
+    key.size = size;
+    key.mode = mode;
+    key.tint = maskColor.isValid() ? maskColor.rgba() : 0;
+    key.devicePixelRatio = devicePixelRatio;
+    key.smooth = smooth;
+    key.alphaMask = alphaMask;
+    return key;
+}
+
+IconRasterizer::IconRasterizer()
+    : QObject()
+{
+    //icon loading is mostly I/O and svg rendering, don't hog all the cores the application may need
+    m_pool.setMaxThreadCount(qBound(1, QThread::idealThreadCount() / 2, 4));
+    //cost is in KiB
+    m_imageCache.setMaxCost(16 * 1024);
+    connect(this, &IconRasterizer::rasterized,
+            this, &IconRasterizer::deliver, Qt::QueuedConnection);
+}
+
+IconRasterizer::~IconRasterizer()
+{
+    m_pool.clear();
+    m_pool.waitForDone();
+}
+
+IconRasterizer *IconRasterizer::self()
+{
+    return s_iconRasterizer;
+}
+
+QThreadPool *IconRasterizer::threadPool()
+{
+    return &m_pool;
+}
+
+QImage IconRasterizer::cachedImage(const IconCacheKey &key)
+{
+    if (!key.isValid()) {
+        return QImage();
+    }
+
+    QImage *image = m_imageCache.object(key);
+    return image ? *image : QImage();
+}
+
+void IconRasterizer::rasterize(QObject *context, const IconRasterRequest &request, const Callback &callback)
+{
+    const IconCacheKey key = request.cacheKey();
+
+    const PendingJob job = {context, callback};
+
+    if (key.isValid()) {
+        auto it = m_runningJobs.constFind(key);
+        if (it != m_runningJobs.constEnd()) {
+            m_pendingJobs[it.value()].append(job);
+            return;
+        }
+    }
+
+    const quint64 id = m_nextId++;
+    m_pendingJobs[id].append(job);
+    if (key.isValid()) {
+        m_runningJobs.insert(key, id);
+        m_runningKeys.insert(id, key);
+    }
+
+    const QString diskCachePath = request.persistable ? IconDiskCache::self()->filePath(key) : QString();
+    IconRasterRequest poolRequest = request;
+
+    //icon engines (QIconLoader, the svg engine, KIconLoader) keep their caches without
+    //any locking, so icons are rendered here in the GUI thread, unless they can be
+    //read from their file in the pool without involving the engine at all
+    if (!poolRequest.filePath.isEmpty()) {
+        poolRequest.icon = QIcon();
+    } else if (!poolRequest.icon.isNull()) {
+        if (!diskCachePath.isEmpty()) {
+            //just a mapping of the file, no decoding
+            const QImage image = IconDiskCache::load(diskCachePath);
+            if (!image.isNull()) {
+                //through the queued connection, as if it came from a job
+                emit rasterized(id, image);
+                return;
+            }
+        }
+        poolRequest.image = poolRequest.icon.pixmap(poolRequest.size, poolRequest.mode, QIcon::On).toImage();
+        poolRequest.icon = QIcon();
+    }
+
+    IconRasterJob *rasterJob = new IconRasterJob(this, id, poolRequest);
+    rasterJob->setDiskCachePath(diskCachePath);
+    m_pool.start(rasterJob);
+}
+
+void IconRasterizer::deliver(quint64 id, const QImage &image)
+{
+    const IconCacheKey key = m_runningKeys.take(id);
+    if (key.isValid()) {
+        m_runningJobs.remove(key);
+        if (!image.isNull()) {
+            m_imageCache.insert(key, new QImage(image), qMax(1, image.byteCount() / 1024));
+        }
+    }
+
+    const QVector<PendingJob> jobs = m_pendingJobs.take(id);
+    for (const PendingJob &job : jobs) {
+        if (job.context && job.callback) {
+            job.callback(image);
+        }
+    }
+}
+
+static int bucketLength(int length)
+{
+    if (length <= 32) {
+        return length;
+    }
+    //8 steps per power of two: 33-64 by 4, 65-128 by 8 and so on
+    int step = 1;
+    while ((step << 4) < length) {
+        step <<= 1;
+    }
+    return (length + step - 1) / step * step;
+}
+
+QSize IconRasterizer::bucketSize(const QSize &size)
+{
+    return QSize(bucketLength(size.width()), bucketLength(size.height()));
+}
+
+QImage IconRasterizer::rasterizeImage(const IconRasterRequest &request)
+{
+    if (!request.size.isValid() || request.size.isEmpty()) {
+        return QImage();
+    }
+
+    //icons aren't safe to render outside of the GUI thread, rasterize() renders them before
+    Q_ASSERT(request.icon.isNull() || !request.filePath.isEmpty() || QThread::currentThread() == qApp->thread());
+
+    QImage img;
+    if (!request.filePath.isEmpty()) {
+        //as QIcon::pixmap() would: fit in the size, scalable images rendered right at it
+        QImageReader reader(request.filePath);
+        const QSize originalSize = reader.size();
+        const bool scalable = reader.format().startsWith("svg");
+        if (originalSize.isValid() && (scalable || originalSize.width() > request.size.width()
+                                       || originalSize.height() > request.size.height())) {
+            reader.setScaledSize(originalSize.scaled(request.size, Qt::KeepAspectRatio));
+        }
+        img = reader.read();
+    } else if (!request.icon.isNull()) {
+        img = request.icon.pixmap(request.size, request.mode, QIcon::On).toImage();
+    } else if (request.fillColor.isValid()) {
+        img = QImage(request.size, QImage::Format_Alpha8);
+        img.fill(request.fillColor);
+    } else {
+        img = request.image;
+    }
+
+    if (!img.isNull() && request.maskColor.isValid()) {
+        if (img.format() != QImage::Format_ARGB32_Premultiplied) {
+            img = img.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+        }
+        QPainter p(&img);
+        p.setCompositionMode(QPainter::CompositionMode_SourceIn);
+        p.fillRect(img.rect(), request.maskColor);
+        p.end();
+    }
+
+    if (img.isNull()) {
+        img = QImage(request.size, QImage::Format_Alpha8);
+        img.fill(Qt::transparent);
+    }
+    //the icon is asked for the exact size, so this is needed only for images
+    //and icons that don't have a size big enough
+    if (img.size() != request.size) {
+        if (request.smooth && img.format() != QImage::Format_ARGB32_Premultiplied && img.format() != QImage::Format_RGB32) {
+            //the only formats the SSE4.1/NEON smooth scaling works on, anything else
+            //would be converted back and forth by QImage::scaled
+            img = img.convertToFormat(img.hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32);
+        }
+        img = img.scaled(request.size, Qt::KeepAspectRatioByExpanding, request.smooth ? Qt::SmoothTransformation : Qt::FastTransformation);
+    }
+
+    if (request.alphaMask && img.format() != QImage::Format_Alpha8) {
+        img = img.convertToFormat(QImage::Format_Alpha8);
+    }
+
+    return img;
+}
+
+#include "moc_iconrasterizer.cpp"
@@ -0,0 +1,176 @@
+/*
+ *   Copyright 2017 Marco Martin <mart@kde.org>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Library General Public License as
+ *   published by the Free Software Foundation; either version 2, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details
+ *
+ *   You should have received a copy of the GNU Library General Public
+ *   License along with this program; if not, write to the
+ *   Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef ICONRASTERIZER_H
+#define ICONRASTERIZER_H
+
+#include <QObject>
+#include <QCache>
+#include <QColor>
+#include <QHash>
+#include <QIcon>
+#include <QImage>
+#include <QPointer>
+#include <QThreadPool>
+#include <QVector>
+
+#include <functional>
+
+/**
+ * Identifies a rasterized icon by its content: two requests with the same key
+ * will produce the very same image, so they can share it and its textures.
+ */
+struct IconCacheKey
+{
+    QString source;
+    QSize size;
+    QIcon::Mode mode = QIcon::Normal;
+    QRgb tint = 0;
+    qreal devicePixelRatio = 1.0;
+    bool smooth = false;
+    bool alphaMask = false;
+
+    bool isValid() const
+    {
+        return !source.isEmpty();
+    }
+};
+
+inline bool operator==(const IconCacheKey &k1, const IconCacheKey &k2)
+{
+    return k1.source == k2.source && k1.size == k2.size && k1.mode == k2.mode
+        && k1.tint == k2.tint && qFuzzyCompare(k1.devicePixelRatio, k2.devicePixelRatio)
+        && k1.smooth == k2.smooth && k1.alphaMask == k2.alphaMask;
+}
+
+inline uint qHash(const IconCacheKey &key, uint seed = 0)
+{
+    return qHash(key.source, seed) ^ qHash(key.size.width() << 16 | key.size.height(), seed)
+        ^ qHash(int(key.mode) << 2 | int(key.smooth) << 1 | int(key.alphaMask), seed) ^ qHash(key.tint, seed);
+}
+
+/**
+ * Everything needed to produce the final image of an icon, resolved on the
+ * GUI thread so that the rasterization itself doesn't have to touch any
+ * QObject, QML engine or theme.
+ */
+struct IconRasterRequest
+{
+    QIcon icon;
+    // the image file the icon was loaded from, if any: it's read in the pool instead of rendering the icon
+    QString filePath;
+    QImage image;
+    QColor fillColor;
+    // when valid, the image is used as a mask and filled with this color
+    QColor maskColor;
+    // only the alpha channel is kept, the color gets applied by the GPU
+    bool alphaMask = false;
+    QSize size;
+    QIcon::Mode mode = QIcon::Normal;
+    bool smooth = false;
+    // identifies the source: if empty, the result won't be cached
+    QString sourceId;
+    // the source is a named theme icon, so it can be cached on disk as well
+    bool persistable = false;
+    // set by IconRasterizer when the disk cache is in use
+    QString diskCachePath;
+    qreal devicePixelRatio = 1.0;
+
+    IconCacheKey cacheKey() const;
+};
+
+/**
+ * Runs the expensive part of the image loading (decoding, svg rendering,
+ * masking and scaling) in a dedicated thread pool, delivering the result back
+ * in the thread IconRasterizer lives in, which is the GUI thread.
+ * Icons loaded from a file are read from it in the pool. Any other QIcon, such
+ * as theme icons, is rendered in the GUI thread, as icon engines aren't thread
+ * safe, but rendering it is skipped when the disk cache already has the result.
+ */
+class IconRasterizer : public QObject
+{
+    Q_OBJECT
+
+public:
+    typedef std::function<void(const QImage &)> Callback;
+
+    IconRasterizer();
+    ~IconRasterizer();
+
+    static IconRasterizer *self();
+
+    /**
+     * The pool the icons are rasterized in, to be used for any other
+     * icon related work that shouldn't happen in the GUI thread.
+     */
+    QThreadPool *threadPool();
+
+    /**
+     * @returns the image already rasterized for @p key, or a null image
+     * if it's not in the cache.
+     * Identical requests get copies of the same image, so ImageTexturesCache
+     * will share a single texture between them as well.
+     */
+    QImage cachedImage(const IconCacheKey &key);
+
+    /**
+     * Queues @p request for rasterization.
+     * @p callback is invoked in the GUI thread once the image is ready,
+     * unless @p context got deleted in the meantime.
+     * Requests with the same cache key of one still running will just wait for it.
+     */
+    void rasterize(QObject *context, const IconRasterRequest &request, const Callback &callback);
+
+    /**
+     * @returns the size icons are rasterized at to be shown at @p size.
+     * Small sizes are kept as they are, to stay pixel exact, bigger ones
+     * are rounded up in steps of about 12%, so that an item being resized
+     * reuses the same image and texture, just scaled by the GPU.
+     */
+    static QSize bucketSize(const QSize &size);
+
+    /**
+     * Does the actual work, it's safe to call from any thread as long
+     * as the request has no icon, or has the file path of its icon.
+     * Other icons have to be rendered in the GUI thread.
+     */
+    static QImage rasterizeImage(const IconRasterRequest &request);
+
+Q_SIGNALS:
+    // emitted from the worker threads, internal use only
+    void rasterized(quint64 id, const QImage &image);
+
+private Q_SLOTS:
+    void deliver(quint64 id, const QImage &image);
+
+private:
+    struct PendingJob {
+        QPointer<QObject> context;
+        Callback callback;
+    };
+
+    QThreadPool m_pool;
+    QHash<quint64, QVector<PendingJob> > m_pendingJobs;
+    QHash<quint64, IconCacheKey> m_runningKeys;
+    QHash<IconCacheKey, quint64> m_runningJobs;
+    QCache<IconCacheKey, QImage> m_imageCache;
+    quint64 m_nextId = 1;
+};
+
+#endif
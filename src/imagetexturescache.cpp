@@ -0,0 +1,283 @@
+/*
+ *   Copyright 2017 Marco Martin <mart@kde.org>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Library General Public License as
+ *   published by the Free Software Foundation; either version 2, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details
+ *
+ *   You should have received a copy of the GNU Library General Public
+ *   License along with this program; if not, write to the
+ *   Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "imagetexturescache.h"
+
+#include <QHash>
+#include <QImage>
+#include <QMap>
+#include <QMutex>
+#include <QSet>
+#include <QSGTexture>
+#include <QtMath>
+
+struct TextureEntry
+{
+    QSGTexture *texture = nullptr;
+    //what is given to the nodes, expires when the last node releases it
+    QWeakPointer<QSGTexture> handle;
+    QWindow *window = nullptr;
+    qint64 id = 0;
+    //the texture's own memory, or the space it takes in the atlas
+    qint64 bytes = 0;
+    bool atlas = false;
+    //position in the lru list, 0 while in use
+    quint64 lastUsed = 0;
+};
+
+typedef QHash<qint64, QHash<QWindow*, TextureEntry *> > TexturesCache;
+
+struct ImageTexturesCachePrivate
+{
+    QSharedPointer<QSGTexture> createHandle(TextureEntry *entry);
+    void release(TextureEntry *entry);
+    void evict(QWindow *window);
+    void deleteEntry(TextureEntry *entry);
+    void windowAboutToStop(QWindow *window);
+
+    mutable QMutex mutex;
+    TexturesCache cache;
+    //unused textures, ordered from the least recently used
+    QMap<quint64, TextureEntry *> lru;
+    quint64 lruCounter = 0;
+    qint64 maximumUnusedBytes = 16 * 1024 * 1024;
+    QSet<QWindow *> connectedWindows;
+    QSet<QWindow *> stoppingWindows;
+    ImageTexturesCache::Statistics stats;
+};
+
+QSharedPointer<QSGTexture> ImageTexturesCachePrivate::createHandle(TextureEntry *entry)
+{
+    QSharedPointer<QSGTexture> handle(entry->texture, [this, entry](QSGTexture *) {
+        release(entry);
+    });
+    entry->handle = handle.toWeakRef();
+    return handle;
+}
+
+void ImageTexturesCachePrivate::release(TextureEntry *entry)
+{
+    //called in the render thread of the entry's window, the only one allowed to delete its textures
+    QMutexLocker locker(&mutex);
+
+    if (stoppingWindows.contains(entry->window)) {
+        deleteEntry(entry);
+        return;
+    }
+
+    entry->lastUsed = ++lruCounter;
+    lru.insert(entry->lastUsed, entry);
+    stats.unusedBytes += entry->bytes;
+    evict(entry->window);
+}
+
+void ImageTexturesCachePrivate::evict(QWindow *window)
+{
+    auto it = lru.begin();
+    while (stats.unusedBytes > maximumUnusedBytes && it != lru.end()) {
+        TextureEntry *entry = it.value();
+        //textures of other windows will be evicted from their own render thread
+        if (entry->window != window) {
+            ++it;
+            continue;
+        }
+        it = lru.erase(it);
+        stats.unusedBytes -= entry->bytes;
+        ++stats.evictions;
+        deleteEntry(entry);
+    }
+}
+
+void ImageTexturesCachePrivate::deleteEntry(TextureEntry *entry)
+{
+    if (entry->atlas) {
+        stats.atlasBytes -= entry->bytes;
+    } else {
+        stats.bytes -= entry->bytes;
+        stats.windowBytes[entry->window] -= entry->bytes;
+        if (stats.windowBytes[entry->window] <= 0) {
+            stats.windowBytes.remove(entry->window);
+        }
+    }
+
+    QHash<QWindow*, TextureEntry *> &textures = cache[entry->id];
+    textures.remove(entry->window);
+    if (textures.isEmpty()) {
+        cache.remove(entry->id);
+    }
+
+    delete entry->texture;
+    delete entry;
+}
+
+void ImageTexturesCachePrivate::windowAboutToStop(QWindow *window)
+{
+    //the graphics context is going away: drop what nobody uses anymore now,
+    //and what is still in use as soon as it gets released
+    QMutexLocker locker(&mutex);
+    stoppingWindows.insert(window);
+
+    auto it = lru.begin();
+    while (it != lru.end()) {
+        TextureEntry *entry = it.value();
+        if (entry->window != window) {
+            ++it;
+            continue;
+        }
+        it = lru.erase(it);
+        stats.unusedBytes -= entry->bytes;
+        deleteEntry(entry);
+    }
+}
+
+Q_GLOBAL_STATIC(ImageTexturesCache, s_imageTexturesCache)
+
+ImageTexturesCache::ImageTexturesCache()
+    : d(new ImageTexturesCachePrivate)
+{
+
+    bool ok = false;
+    const qint64 size = qgetenv("KIRIGAMI_TEXTURE_CACHE_SIZE").toLongLong(&ok);
+    if (ok && size >= 0) {
+        d->maximumUnusedBytes = size * 1024;
+    }
+}
+
+ImageTexturesCache::~ImageTexturesCache()
+{
+    //at this point all the windows are gone, as are their graphics contexts
+    for (TextureEntry *entry : d->lru) {
+        delete entry;
+    }
+}
+
+ImageTexturesCache *ImageTexturesCache::self()
+{
+    return s_imageTexturesCache;
+}
+
+int ImageTexturesCache::maximumAtlasSize()
+{
+    return 64;
+}
+
+qint64 ImageTexturesCache::maximumUnusedBytes() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->maximumUnusedBytes;
+}
+
+void ImageTexturesCache::setMaximumUnusedBytes(qint64 bytes)
+{
+    QMutexLocker locker(&d->mutex);
+    //will be applied by each window as soon as it touches the cache again
+    d->maximumUnusedBytes = qMax<qint64>(0, bytes);
+}
+
+ImageTexturesCache::Statistics ImageTexturesCache::statistics() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->stats;
+}
+
+QSharedPointer<QSGTexture> ImageTexturesCache::loadTexture(QQuickWindow *window, const QImage &image, QQuickWindow::CreateTextureOptions options)
+{
+    qint64 id = image.cacheKey();
+    QSharedPointer<QSGTexture> texture;
+
+    {
+        QMutexLocker locker(&d->mutex);
+
+        if (!d->connectedWindows.contains(window)) {
+            d->connectedWindows.insert(window);
+            QObject::connect(window, &QQuickWindow::sceneGraphAboutToStop, [this, window]() {
+                d->windowAboutToStop(window);
+            });
+            QObject::connect(window, &QObject::destroyed, [this, window]() {
+                QMutexLocker locker(&d->mutex);
+                d->connectedWindows.remove(window);
+                d->stoppingWindows.remove(window);
+            });
+        }
+        //we're rendering again
+        d->stoppingWindows.remove(window);
+
+        TextureEntry *entry = d->cache.value(id).value(window);
+        if (entry) {
+            ++d->stats.hits;
+            texture = entry->handle.toStrongRef();
+            if (!texture) {
+                //it was unused, take it back from the lru list
+                d->lru.remove(entry->lastUsed);
+                entry->lastUsed = 0;
+                d->stats.unusedBytes -= entry->bytes;
+                texture = d->createHandle(entry);
+            }
+        } else {
+            ++d->stats.misses;
+        }
+    }
+
+    if (!texture) {
+        //creating the texture can take a while, don't block other render threads meanwhile:
+        //nobody else can add a texture for this window anyways
+        QSGTexture *newTexture = window->createTextureFromImage(image, options);
+        if (!newTexture) {
+            return texture;
+        }
+
+        TextureEntry *entry = new TextureEntry;
+        entry->texture = newTexture;
+        entry->window = window;
+        entry->id = id;
+        entry->atlas = newTexture->isAtlasTexture();
+        entry->bytes = qint64(newTexture->textureSize().width()) * newTexture->textureSize().height() * qMax(1, image.depth() / 8);
+
+        QMutexLocker locker(&d->mutex);
+        d->cache[id][window] = entry;
+        if (entry->atlas) {
+            d->stats.atlasBytes += entry->bytes;
+        } else {
+            d->stats.bytes += entry->bytes;
+            d->stats.windowBytes[window] += entry->bytes;
+        }
+        texture = d->createHandle(entry);
+    }
+
+    //if we have a cache in an atlas but our request cannot use an atlassed texture
+    //create a new texture and use that
+    //don't use removedFromAtlas() as that requires keeping a reference to the non atlased version
+    if (!(options & QQuickWindow::TextureCanUseAtlas) && texture->isAtlasTexture()) {
+        texture = QSharedPointer<QSGTexture>(window->createTextureFromImage(image, options));
+    }
+
+    return texture;
+}
+
+QSharedPointer<QSGTexture> ImageTexturesCache::loadTexture(QQuickWindow *window, const QImage &image)
+{
+    const int maxSize = qCeil(maximumAtlasSize() * window->devicePixelRatio());
+
+    QQuickWindow::CreateTextureOptions options = 0;
+    if (image.width() <= maxSize && image.height() <= maxSize) {
+        options |= QQuickWindow::TextureCanUseAtlas;
+    }
+
+    return loadTexture(window, image, options);
+}
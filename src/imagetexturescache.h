@@ -0,0 +1,108 @@
+/*
+ *   Copyright 2017 Marco Martin <mart@kde.org>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Library General Public License as
+ *   published by the Free Software Foundation; either version 2, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details
+ *
+ *   You should have received a copy of the GNU Library General Public
+ *   License along with this program; if not, write to the
+ *   Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef IMAGETEXTURESCACHE_H
+#define IMAGETEXTURESCACHE_H
+
+#include <QHash>
+#include <QQuickWindow>
+#include <QSharedPointer>
+#include <QScopedPointer>
+
+class QImage;
+class QSGTexture;
+struct ImageTexturesCachePrivate;
+
+/**
+ * Helps to manage textures by providing a caching mechanism to avoid
+ * creating textures for images that are already loaded.
+ *
+ * Small images, such as the icons of toolbars and list items, are packed
+ * in the texture atlas of their window, so the scene graph can batch
+ * them in few draw calls.
+ *
+ * When the last node using a texture goes away, the texture is not deleted
+ * right away but kept around, so scrolling back to an item doesn't need a new
+ * upload. Those unused textures are kept up to maximumUnusedBytes() and
+ * evicted in least recently used order. Textures still in use are never evicted.
+ *
+ * Sizes are estimated from the images, at their own depth: the memory
+ * actually used depends on the scene graph backend and the driver.
+ * Textures in the atlas don't own any memory, but they take space in it.
+ */
+class ImageTexturesCache
+{
+public:
+    struct Statistics {
+        quint64 hits = 0;
+        quint64 misses = 0;
+        quint64 evictions = 0;
+        // owned by all the textures known to the cache, used or not
+        qint64 bytes = 0;
+        // taken in the atlases by all the textures known to the cache
+        qint64 atlasBytes = 0;
+        // owned or taken in the atlases by the textures kept around without any user
+        qint64 unusedBytes = 0;
+        QHash<QWindow *, qint64> windowBytes;
+    };
+
+    ImageTexturesCache();
+    ~ImageTexturesCache();
+
+    static ImageTexturesCache *self();
+
+    /**
+     * @returns the texture for a given @p window and @p image.
+     *
+     * If an @p image id is the same as one already provided before, we won't create
+     * a new texture and return a shared pointer to the existing texture.
+     */
+    QSharedPointer<QSGTexture> loadTexture(QQuickWindow *window, const QImage &image, QQuickWindow::CreateTextureOptions options);
+
+    /**
+     * Same as above, images no bigger than maximumAtlasSize() logical pixels
+     * will go in the atlas.
+     */
+    QSharedPointer<QSGTexture> loadTexture(QQuickWindow *window, const QImage &image);
+
+    /**
+     * Images bigger than this, in logical pixels, get a texture of their own.
+     */
+    static int maximumAtlasSize();
+
+    /**
+     * How many bytes of textures not used by any node can be kept around,
+     * counting the atlas space they take for the ones in the atlas.
+     * It defaults to 16 MiB, or the value in KiB of the environment variable
+     * KIRIGAMI_TEXTURE_CACHE_SIZE.
+     */
+    qint64 maximumUnusedBytes() const;
+    void setMaximumUnusedBytes(qint64 bytes);
+
+    /**
+     * @returns a snapshot of hits, misses, evictions and memory usage.
+     * Can be called from any thread.
+     */
+    Statistics statistics() const;
+
+private:
+    QScopedPointer<ImageTexturesCachePrivate> d;
+};
+
+#endif
@@ -22,8 +22,10 @@
 #include "kirigamiplugin.h"
 #include "enums.h"
 #include "desktopicon.h"
+#include "pagerowmodel.h"
 #include "settings.h"
 
+#include <QDir>
 #include <QQmlEngine>
 #include <QQmlContext>
 #include <QQuickItem>
@@ -39,23 +41,37 @@ static QString s_selectedStyle;
 
 QUrl KirigamiPlugin::componentUrl(const QString &fileName) const
 {
-    foreach (const QString &style, m_stylesFallbackChain) {
-        const QString candidate = QStringLiteral("styles/") + style + QLatin1Char('/') + fileName;
-        if (QFile::exists(resolveFilePath(candidate))) {
-            return QUrl(resolveFileUrl(candidate));
-        }
+    auto it = m_styleComponents.constFind(fileName);
+    if (it != m_styleComponents.constEnd()) {
+        return it.value();
     }
     return QUrl(resolveFileUrl(fileName));
 }
 
+void KirigamiPlugin::buildStyleIndex()
+{
+    m_styleComponents.clear();
+
+    //one directory listing per style instead of a stat per component and style,
+    //going from the last fallback so the preferred styles override it
+    for (int i = m_stylesFallbackChain.count() - 1; i >= 0; --i) {
+        const QString styleDir = QStringLiteral("styles/") + m_stylesFallbackChain.at(i);
+        const QStringList fileNames = QDir(resolveFilePath(QLatin1Char('/') + styleDir)).entryList(QStringList() << QStringLiteral("*.qml"), QDir::Files);
+        for (const QString &fileName : fileNames) {
+            m_styleComponents.insert(fileName, QUrl(resolveFileUrl(styleDir + QLatin1Char('/') + fileName)));
+        }
+    }
+}
+
 
 void KirigamiPlugin::registerTypes(const char *uri)
 {
     Q_ASSERT(uri == QLatin1String("org.kde.kirigami"));
     const QString style = QQuickStyle::name();
+    const QStringList availableStyles = QDir(resolveFilePath(QStringLiteral("/styles"))).entryList(QDir::Dirs | QDir::NoDotAndDotDot);
 
     //org.kde.desktop.plasma is a couple of files that fall back to desktop by purpose
-    if ((style.isEmpty() || style == QStringLiteral("org.kde.desktop.plasma")) && QFile::exists(resolveFilePath(QStringLiteral("/styles/org.kde.desktop")))) {
+    if ((style.isEmpty() || style == QStringLiteral("org.kde.desktop.plasma")) && availableStyles.contains(QStringLiteral("org.kde.desktop"))) {
 #if !defined(Q_OS_ANDROID) && !defined(Q_OS_IOS)
         m_stylesFallbackChain.prepend(QStringLiteral("org.kde.desktop"));
 #elif defined(Q_OS_ANDROID)
@@ -65,10 +81,10 @@ void KirigamiPlugin::registerTypes(const char *uri)
 #endif
     }
 
-    if (!style.isEmpty() && QFile::exists(resolveFilePath(QStringLiteral("/styles/") + style))) {
+    if (!style.isEmpty() && availableStyles.contains(style)) {
         m_stylesFallbackChain.prepend(style);
         //if we have plasma deps installed, use them for extra integration
-        if (style == QStringLiteral("org.kde.desktop") && QFile::exists(resolveFilePath(QStringLiteral("/styles/org.kde.desktop.plasma")))) {
+        if (style == QStringLiteral("org.kde.desktop") && availableStyles.contains(QStringLiteral("org.kde.desktop.plasma"))) {
             m_stylesFallbackChain.prepend("org.kde.desktop.plasma");
         }
     } else {
@@ -77,6 +93,7 @@ void KirigamiPlugin::registerTypes(const char *uri)
     //At this point the fallback chain will be selected->org.kde.desktop->Fallback
 
     s_selectedStyle = m_stylesFallbackChain.first();
+    buildStyleIndex();
 
     qmlRegisterSingletonType<Settings>(uri, 2, 0, "Settings",
          [](QQmlEngine*, QJSEngine*) -> QObject* {
@@ -126,7 +143,8 @@ void KirigamiPlugin::registerTypes(const char *uri)
     qmlRegisterType(componentUrl(QStringLiteral("OverlaySheet.qml")), uri, 2, 0, "OverlaySheet");
     qmlRegisterType(componentUrl(QStringLiteral("Page.qml")), uri, 2, 0, "Page");
     qmlRegisterType(componentUrl(QStringLiteral("ScrollablePage.qml")), uri, 2, 0, "ScrollablePage");
-    qmlRegisterType(componentUrl(QStringLiteral("SplitDrawer.qml")), uri, 2, 0, "SplitDrawer");
+    //there is no SplitDrawer.qml anymore: fail with a meaningful error rather than a missing file
+    qmlRegisterTypeNotAvailable(uri, 2, 0, "SplitDrawer", QStringLiteral("SplitDrawer is not available anymore, use OverlayDrawer with modal: false instead"));
     qmlRegisterType(componentUrl(QStringLiteral("SwipeListItem.qml")), uri, 2, 0, "SwipeListItem");
 
     //2.1
@@ -136,7 +154,34 @@ void KirigamiPlugin::registerTypes(const char *uri)
     qmlRegisterType(componentUrl(QStringLiteral("ApplicationItem.qml")), uri, 2, 1, "ApplicationItem");
 
     qmlProtectModule(uri, 2);
+
+#ifdef KIRIGAMI_BUILD_TYPE_STATIC
+    //not called from a plugin loader here, no need to wait for initializeEngine
+    registerPrivateTypes();
+#endif
 }
 
+void KirigamiPlugin::registerPrivateTypes()
+{
+    static bool registered = false;
+    if (registered) {
+        return;
+    }
+    registered = true;
+
+    //types used by the components only, they aren't part of the API of org.kde.kirigami
+    qmlRegisterType<PageRowModel>("org.kde.kirigami.private", 2, 2, "PageRowModel");
+}
+
+#ifndef KIRIGAMI_BUILD_TYPE_STATIC
+void KirigamiPlugin::initializeEngine(QQmlEngine *engine, const char *uri)
+{
+    Q_UNUSED(engine)
+    Q_UNUSED(uri)
+    //types can only go in the plugin's own module from registerTypes()
+    registerPrivateTypes();
+}
+#endif
+
 #include "moc_kirigamiplugin.cpp"
 
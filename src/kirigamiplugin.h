@@ -23,10 +23,12 @@
 #define MOBILECOMPONENTSPLUGIN_H
 
 #ifdef KIRIGAMI_BUILD_TYPE_STATIC
+#include <QHash>
 #include <QObject>
 #include <QString>
 #include <QUrl>
 #else
+#include <QHash>
 #include <QQmlEngine>
 #include <QQmlExtensionPlugin>
 #include <QUrl>
@@ -46,6 +48,7 @@ public:
     KirigamiPlugin(KirigamiPlugin const&) = delete;
     void operator=(KirigamiPlugin const&) = delete;
     void registerTypes(const char *uri);
+    static void registerPrivateTypes();
     static void registerTypes()
     {
         getInstance().registerTypes("org.kde.kirigami");
@@ -65,7 +68,10 @@ private:
         }
         return QStringLiteral("qrc:/") + filePath;
     }
+    void buildStyleIndex();
     QStringList m_stylesFallbackChain;
+    //file name -> url of the component from the first style of the chain that has it
+    QHash<QString, QUrl> m_styleComponents;
 };
 
 #else
@@ -77,8 +83,10 @@ class KirigamiPlugin : public QQmlExtensionPlugin
 
 public:
     void registerTypes(const char *uri) Q_DECL_OVERRIDE;
+    void initializeEngine(QQmlEngine *engine, const char *uri) Q_DECL_OVERRIDE;
 
 private:
+    static void registerPrivateTypes();
     QUrl componentUrl(const QString &fileName) const;
     QString resolveFilePath(const QString &path) const
     {
@@ -88,7 +96,10 @@ private:
     {
         return baseUrl().toString() + QLatin1Char('/') + filePath;
     }
+    void buildStyleIndex();
     QStringList m_stylesFallbackChain;
+    //file name -> url of the component from the first style of the chain that has it
+    QHash<QString, QUrl> m_styleComponents;
 };
 
 #endif
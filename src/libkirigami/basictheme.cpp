@@ -24,6 +24,7 @@
 #include <QPalette>
 #include <QDebug>
 #include <QQuickWindow>
+#include <QMetaProperty>
 #include <QTimer>
 
 namespace Kirigami {
@@ -44,6 +45,17 @@ BasicThemeDeclarative::BasicThemeDeclarative()
     m_colorSyncTimer = new QTimer;
     m_colorSyncTimer->setInterval(0);
     m_colorSyncTimer->setSingleShot(true);
+
+    m_defaultFont = qApp->font();
+    //TODO: correct?
+    QObject::connect(qApp, &QGuiApplication::fontDatabaseChanged, m_colorSyncTimer, [this]() {
+        updateDefaultFont();
+    });
+#if QT_VERSION >= QT_VERSION_CHECK(5, 11, 0)
+    QObject::connect(qApp, &QGuiApplication::fontChanged, m_colorSyncTimer, [this]() {
+        updateDefaultFont();
+    });
+#endif
 }
 
 BasicThemeDeclarative::~BasicThemeDeclarative()
@@ -70,61 +82,154 @@ QObject *BasicThemeDeclarative::instance(const BasicTheme *theme)
     QObject *obj = c.create();
     m_declarativeBasicTheme = obj->property("theme").value<QObject *>();
 
+    //any color change restarts the timer to compress, the themes are synced when it's done
+    const QMetaMethod startSlot = m_colorSyncTimer->metaObject()->method(m_colorSyncTimer->metaObject()->indexOfSlot("start()"));
+    const QMetaObject *mo = m_declarativeBasicTheme->metaObject();
+    for (int i = 0; i < mo->propertyCount(); ++i) {
+        const QMetaProperty property = mo->property(i);
+        if (property.userType() == QMetaType::QColor && property.hasNotifySignal()) {
+            QObject::connect(m_declarativeBasicTheme, property.notifySignal(), m_colorSyncTimer, startSlot);
+        }
+    }
+    //connected before any BasicTheme, so the table is updated before they sync
+    QObject::connect(m_colorSyncTimer, &QTimer::timeout, m_colorSyncTimer, [this]() {
+        readColors();
+    });
+    readColors();
+
     return m_declarativeBasicTheme;
 }
 
+void BasicThemeDeclarative::readColors()
+{
+    if (!m_declarativeBasicTheme) {
+        return;
+    }
+
+    static const char *colorSetPrefixes[PlatformTheme::Complementary + 1] = {
+        "view", "", "button", "selection", "tooltip", "complementary"
+    };
+    static const char *roleNames[ColorRoleCount] = {
+        "TextColor", "BackgroundColor", "HoverColor", "FocusColor"
+    };
+    //the Window colors are the unprefixed ones
+    static const char *windowRoleNames[ColorRoleCount] = {
+        "textColor", "backgroundColor", "hoverColor", "focusColor"
+    };
+    static const char *commonNames[CommonColorCount] = {
+        "disabledTextColor", "highlightColor", "highlightedTextColor", "activeTextColor", "linkColor",
+        "visitedLinkColor", "negativeTextColor", "neutralTextColor", "positiveTextColor"
+    };
+
+    for (int set = 0; set <= PlatformTheme::Complementary; ++set) {
+        for (int role = 0; role < ColorRoleCount; ++role) {
+            const QByteArray name = set == PlatformTheme::Window ? QByteArray(windowRoleNames[role])
+                : QByteArray(colorSetPrefixes[set]) + roleNames[role];
+            m_colors[set][role] = m_declarativeBasicTheme->property(name.constData()).value<QColor>();
+        }
+    }
+
+    for (int i = 0; i < CommonColorCount; ++i) {
+        m_commonColors[i] = m_declarativeBasicTheme->property(commonNames[i]).value<QColor>();
+    }
+
+    const QColor tooltipText = m_colors[PlatformTheme::Tooltip][TextColor];
+    const QColor tooltipBackground = m_colors[PlatformTheme::Tooltip][BackgroundColor];
+    for (int set = 0; set <= PlatformTheme::Complementary; ++set) {
+        const QColor text = m_colors[set][TextColor];
+        const QColor background = m_colors[set][BackgroundColor];
+
+        QPalette palette;
+        palette.setColor(QPalette::WindowText, text);
+        palette.setColor(QPalette::Window, background);
+        palette.setColor(QPalette::Text, text);
+        palette.setColor(QPalette::Base, background);
+        palette.setColor(QPalette::AlternateBase, background);
+        palette.setColor(QPalette::ButtonText, text);
+        palette.setColor(QPalette::Button, background);
+        palette.setColor(QPalette::BrightText, m_commonColors[HighlightedTextColor]);
+        palette.setColor(QPalette::Highlight, m_commonColors[HighlightColor]);
+        palette.setColor(QPalette::HighlightedText, m_commonColors[HighlightedTextColor]);
+        palette.setColor(QPalette::Link, m_commonColors[LinkColor]);
+        palette.setColor(QPalette::LinkVisited, m_commonColors[VisitedLinkColor]);
+        palette.setColor(QPalette::ToolTipText, tooltipText);
+        palette.setColor(QPalette::ToolTipBase, tooltipBackground);
+
+        palette.setColor(QPalette::Disabled, QPalette::WindowText, m_commonColors[DisabledTextColor]);
+        palette.setColor(QPalette::Disabled, QPalette::Text, m_commonColors[DisabledTextColor]);
+        palette.setColor(QPalette::Disabled, QPalette::ButtonText, m_commonColors[DisabledTextColor]);
+
+        m_palettes[set] = palette;
+    }
+}
+
+QColor BasicThemeDeclarative::color(PlatformTheme::ColorSet colorSet, ColorRole role) const
+{
+    if (colorSet < PlatformTheme::View || colorSet > PlatformTheme::Complementary) {
+        colorSet = PlatformTheme::Window;
+    }
+    return m_colors[colorSet][role];
+}
+
+QColor BasicThemeDeclarative::commonColor(CommonColor color) const
+{
+    return m_commonColors[color];
+}
+
+QFont BasicThemeDeclarative::defaultFont() const
+{
+    return m_defaultFont;
+}
+
+void BasicThemeDeclarative::registerTheme(BasicTheme *theme)
+{
+    m_themes.insert(theme);
+}
+
+void BasicThemeDeclarative::unregisterTheme(BasicTheme *theme)
+{
+    m_themes.remove(theme);
+}
+
+void BasicThemeDeclarative::updateDefaultFont()
+{
+    if (m_defaultFont == qApp->font()) {
+        return;
+    }
+    m_defaultFont = qApp->font();
+
+    //a single connection for all the themes, they just take the new shared font
+    QVector<QPointer<BasicTheme> > themes;
+    themes.reserve(m_themes.count());
+    for (BasicTheme *theme : m_themes) {
+        themes << theme;
+    }
+    //defaultFontChanged handlers may delete some of them
+    for (const QPointer<BasicTheme> &theme : themes) {
+        if (theme) {
+            theme->syncFont();
+        }
+    }
+}
+
+QPalette BasicThemeDeclarative::palette(PlatformTheme::ColorSet colorSet) const
+{
+    if (colorSet < PlatformTheme::View || colorSet > PlatformTheme::Complementary) {
+        colorSet = PlatformTheme::Window;
+    }
+    return m_palettes[colorSet];
+}
+
 
 
 BasicTheme::BasicTheme(QObject *parent)
     : PlatformTheme(parent)
 {
-    //TODO: correct?
-    connect(qApp, &QGuiApplication::fontDatabaseChanged, this, [this]() {setDefaultFont(qApp->font());});
-
-    //connect all the declarative object signals to the timer start to compress, use the old syntax as they are all signals defined in QML
-    connect(basicThemeDeclarative()->instance(this), SIGNAL(textColorChanged()),
-            basicThemeDeclarative()->m_colorSyncTimer, SLOT(start()));
-    connect(basicThemeDeclarative()->instance(this), SIGNAL(disabledTextColorChanged()),
-            basicThemeDeclarative()->m_colorSyncTimer, SLOT(start()));
-    connect(basicThemeDeclarative()->instance(this), SIGNAL(highlightColorChanged()),
-            basicThemeDeclarative()->m_colorSyncTimer, SLOT(start()));
-    connect(basicThemeDeclarative()->instance(this), SIGNAL(highlightedTextColorChanged()),
-            basicThemeDeclarative()->m_colorSyncTimer, SLOT(start()));
-    connect(basicThemeDeclarative()->instance(this), SIGNAL(backgroundColorChanged()),
-            basicThemeDeclarative()->m_colorSyncTimer, SLOT(start()));
-    connect(basicThemeDeclarative()->instance(this), SIGNAL(linkColorChanged()),
-            basicThemeDeclarative()->m_colorSyncTimer, SLOT(start()));
-    connect(basicThemeDeclarative()->instance(this), SIGNAL(visitedLinkColorChanged()),
-            basicThemeDeclarative()->m_colorSyncTimer, SLOT(start()));
-
-    connect(basicThemeDeclarative()->instance(this), SIGNAL(buttonTextColorChanged()),
-            basicThemeDeclarative()->m_colorSyncTimer, SLOT(start()));
-    connect(basicThemeDeclarative()->instance(this), SIGNAL(buttonBackgroundColorChanged()),
-            basicThemeDeclarative()->m_colorSyncTimer, SLOT(start()));
-    connect(basicThemeDeclarative()->instance(this), SIGNAL(buttonHoverColorChanged()),
-            basicThemeDeclarative()->m_colorSyncTimer, SLOT(start()));
-    connect(basicThemeDeclarative()->instance(this), SIGNAL(buttonFocusColorChanged()),
-            basicThemeDeclarative()->m_colorSyncTimer, SLOT(start()));
-
-    connect(basicThemeDeclarative()->instance(this), SIGNAL(viewTextColorChanged()),
-            basicThemeDeclarative()->m_colorSyncTimer, SLOT(start()));
-    connect(basicThemeDeclarative()->instance(this), SIGNAL(viewBackgroundColorChanged()), 
-            basicThemeDeclarative()->m_colorSyncTimer, SLOT(start()));
-    connect(basicThemeDeclarative()->instance(this), SIGNAL(viewHoverColorChanged()),
-            basicThemeDeclarative()->m_colorSyncTimer, SLOT(start()));
-    connect(basicThemeDeclarative()->instance(this), SIGNAL(viewFocusColorChanged()),
-            basicThemeDeclarative()->m_colorSyncTimer, SLOT(start()));
-
-    connect(basicThemeDeclarative()->instance(this), SIGNAL(complementaryTextColorChanged()),
-            basicThemeDeclarative()->m_colorSyncTimer, SLOT(start()));
-    connect(basicThemeDeclarative()->instance(this), SIGNAL(complementaryBackgroundColorChanged()),
-            basicThemeDeclarative()->m_colorSyncTimer, SLOT(start()));
-    connect(basicThemeDeclarative()->instance(this), SIGNAL(complementaryHoverColorChanged()),
-            basicThemeDeclarative()->m_colorSyncTimer, SLOT(start()));
-    connect(basicThemeDeclarative()->instance(this), SIGNAL(complementaryFocusColorChanged()),
-            basicThemeDeclarative()->m_colorSyncTimer, SLOT(start()));
-
-    //finally connect the timer to the sync
+    basicThemeDeclarative()->registerTheme(this);
+
+    //creates the declarative theme and the color table on first use
+    basicThemeDeclarative()->instance(this);
+
     connect(basicThemeDeclarative()->m_colorSyncTimer, &QTimer::timeout,
             this, &BasicTheme::syncColors);
     connect(this, &BasicTheme::colorSetChanged,
@@ -135,137 +240,96 @@ BasicTheme::BasicTheme(QObject *parent)
                 }
             });
     syncColors();
+    //after the colors, so it goes in the same copy of the data
+    syncFont();
 }
 
 BasicTheme::~BasicTheme()
 {
+    if (!privateBasicThemeDeclarativeSelf.isDestroyed()) {
+        basicThemeDeclarative()->unregisterTheme(this);
+    }
 }
 
-//TODO: tint for which we need to chain to m_parentBasicTheme's color
-#define RESOLVECOLOR(colorName, upperCaseColor) \
-    QColor color;\
-    switch (colorSet()) {\
-    case BasicTheme::Button:\
-        color = basicThemeDeclarative()->instance(this)->property("button"#upperCaseColor).value<QColor>();\
-        break;\
-    case BasicTheme::View:\
-        color = basicThemeDeclarative()->instance(this)->property("view"#upperCaseColor).value<QColor>();\
-        break;\
-    case BasicTheme::Selection:\
-        color = basicThemeDeclarative()->instance(this)->property("selection"#upperCaseColor).value<QColor>();\
-        break;\
-    case BasicTheme::Tooltip:\
-        color = basicThemeDeclarative()->instance(this)->property("tooltip"#upperCaseColor).value<QColor>();\
-        break;\
-    case BasicTheme::Complementary:\
-        color = basicThemeDeclarative()->instance(this)->property("complementary"#upperCaseColor).value<QColor>();\
-        break;\
-    case BasicTheme::Window:\
-    default:\
-        color = basicThemeDeclarative()->instance(this)->property(#colorName).value<QColor>();\
-    }\
-
-
-#define PROXYCOLOR(colorName, upperCaseColor) \
-    basicThemeDeclarative()->instance(this)->property(#colorName).value<QColor>()
-
+void BasicTheme::syncFont()
+{
+    setDefaultFont(basicThemeDeclarative()->defaultFont());
+}
 
+//TODO: tint for which we need to chain to m_parentBasicTheme's color
 void BasicTheme::syncColors()
 {
-    {
-        RESOLVECOLOR(textColor, TextColor);
-        setTextColor(color);
-    }{
-        setDisabledTextColor(PROXYCOLOR(disabledTextColor, DisabledTextColor));
-    }{
-        RESOLVECOLOR(backgroundColor, BackgroundColor)
-        setBackgroundColor(color);
-    }{
-        setHighlightColor(PROXYCOLOR(highlightColor, HighlightColor));
-    }{
-        setHighlightedTextColor(PROXYCOLOR(highlightedTextColor, HighlightedTextColor));
-    }{
-        setActiveTextColor(PROXYCOLOR(activeTextColor, ActiveTextColor));
-    }{
-        setLinkColor(PROXYCOLOR(linkColor, LinkColor));
-    }{
-        setVisitedLinkColor(PROXYCOLOR(visitedLinkColor, VisitedLinkColor));
-    }{
-        setNegativeTextColor(PROXYCOLOR(negativeTextColor, NegativeTextColor));
-    }{
-        setNeutralTextColor(PROXYCOLOR(neutralTextColor, NeutralTextColor));
-    }{
-        setPositiveTextColor(PROXYCOLOR(positiveTextColor, PositiveTextColor));
-    }{
-        RESOLVECOLOR(hoverColor, HoverColor);
-        setHoverColor(color);
-    }{
-        RESOLVECOLOR(focusColor, FocusColor);
-        setFocusColor(color);
-    }
+    const BasicThemeDeclarative *table = basicThemeDeclarative();
+    const PlatformTheme::ColorSet set = colorSet();
+
+    setTextColor(table->color(set, BasicThemeDeclarative::TextColor));
+    setBackgroundColor(table->color(set, BasicThemeDeclarative::BackgroundColor));
+    setHoverColor(table->color(set, BasicThemeDeclarative::HoverColor));
+    setFocusColor(table->color(set, BasicThemeDeclarative::FocusColor));
+
+    setDisabledTextColor(table->commonColor(BasicThemeDeclarative::DisabledTextColor));
+    setHighlightColor(table->commonColor(BasicThemeDeclarative::HighlightColor));
+    setHighlightedTextColor(table->commonColor(BasicThemeDeclarative::HighlightedTextColor));
+    setActiveTextColor(table->commonColor(BasicThemeDeclarative::ActiveTextColor));
+    setLinkColor(table->commonColor(BasicThemeDeclarative::LinkColor));
+    setVisitedLinkColor(table->commonColor(BasicThemeDeclarative::VisitedLinkColor));
+    setNegativeTextColor(table->commonColor(BasicThemeDeclarative::NegativeTextColor));
+    setNeutralTextColor(table->commonColor(BasicThemeDeclarative::NeutralTextColor));
+    setPositiveTextColor(table->commonColor(BasicThemeDeclarative::PositiveTextColor));
+
+    //a shallow copy: comparing and assigning it is cheap as well
+    setPalette(table->palette(set));
 
-    //legacy
-    {
-        m_buttonTextColor = PROXYCOLOR(buttonTextColor, ButtonTextColor);
-        m_buttonBackgroundColor = PROXYCOLOR(buttonBackgroundColor, ButtonBackgroundColor);
-        m_buttonHoverColor = PROXYCOLOR(buttonHoverColor, ButtonHoverColor);
-        m_buttonFocusColor = PROXYCOLOR(buttonFocusColor, ButtonFocusColor);
-        m_viewTextColor = PROXYCOLOR(viewTextColor, ViewTextColor);
-        m_viewBackgroundColor = PROXYCOLOR(viewBackgroundColor, ViewBackgroundColor);
-        m_viewHoverColor = PROXYCOLOR(viewHoverColor, ViewHoverColor);
-        m_viewFocusColor = PROXYCOLOR(viewFocusColor, ViewFocusColor);
-    }
-    //TODO: build the qpalette
     emit colorsChanged();
 }
 
 QColor BasicTheme::buttonTextColor() const
 {
     qWarning()<<"WARNING: buttonTextColor is deprecated, use textColor with colorSet: Theme.Button instead";
-    return m_buttonTextColor;
+    return basicThemeDeclarative()->color(PlatformTheme::Button, BasicThemeDeclarative::TextColor);
 }
 
 QColor BasicTheme::buttonBackgroundColor() const
 {
     qWarning()<<"WARNING: buttonBackgroundColor is deprecated, use backgroundColor with colorSet: Theme.Button instead";
-    return m_buttonBackgroundColor;
+    return basicThemeDeclarative()->color(PlatformTheme::Button, BasicThemeDeclarative::BackgroundColor);
 }
 
 QColor BasicTheme::buttonHoverColor() const
 {
     qWarning()<<"WARNING: buttonHoverColor is deprecated, use backgroundColor with colorSet: Theme.Button instead";
-    return m_buttonHoverColor;
+    return basicThemeDeclarative()->color(PlatformTheme::Button, BasicThemeDeclarative::HoverColor);
 }
 
 QColor BasicTheme::buttonFocusColor() const
 {
     qWarning()<<"WARNING: buttonFocusColor is deprecated, use backgroundColor with colorSet: Theme.Button instead";
-    return m_buttonFocusColor;
+    return basicThemeDeclarative()->color(PlatformTheme::Button, BasicThemeDeclarative::FocusColor);
 }
 
 
 QColor BasicTheme::viewTextColor() const
 {
     qWarning()<<"WARNING: viewTextColor is deprecated, use backgroundColor with colorSet: Theme.View instead";
-    return m_viewTextColor;
+    return basicThemeDeclarative()->color(PlatformTheme::View, BasicThemeDeclarative::TextColor);
 }
 
 QColor BasicTheme::viewBackgroundColor() const
 {
     qWarning()<<"WARNING: viewBackgroundColor is deprecated, use backgroundColor with colorSet: Theme.View instead";
-    return m_viewBackgroundColor;
+    return basicThemeDeclarative()->color(PlatformTheme::View, BasicThemeDeclarative::BackgroundColor);
 }
 
 QColor BasicTheme::viewHoverColor() const
 {
     qWarning()<<"WARNING: viewHoverColor is deprecated, use backgroundColor with colorSet: Theme.View instead";
-    return m_viewHoverColor;
+    return basicThemeDeclarative()->color(PlatformTheme::View, BasicThemeDeclarative::HoverColor);
 }
 
 QColor BasicTheme::viewFocusColor() const
 {
     qWarning()<<"WARNING: viewFocusColor is deprecated, use backgroundColor with colorSet: Theme.View instead";
-    return m_viewFocusColor;
+    return basicThemeDeclarative()->color(PlatformTheme::View, BasicThemeDeclarative::FocusColor);
 }
 
 BasicThemeDeclarative *BasicTheme::basicThemeDeclarative()
@@ -25,6 +25,8 @@
 #include <QQuickItem>
 #include <QColor>
 #include <QPointer>
+#include <QFont>
+#include <QSet>
 
 namespace Kirigami {
 
@@ -33,16 +35,58 @@ class BasicTheme;
 class BasicThemeDeclarative
 {
 public:
+    //the colors which depend on the color set
+    enum ColorRole {
+        TextColor = 0,
+        BackgroundColor,
+        HoverColor,
+        FocusColor,
+        ColorRoleCount
+    };
+
+    //the colors which are the same for every color set
+    enum CommonColor {
+        DisabledTextColor = 0,
+        HighlightColor,
+        HighlightedTextColor,
+        ActiveTextColor,
+        LinkColor,
+        VisitedLinkColor,
+        NegativeTextColor,
+        NeutralTextColor,
+        PositiveTextColor,
+        CommonColorCount
+    };
+
     BasicThemeDeclarative();
     virtual ~BasicThemeDeclarative();
 
     QObject *instance(const BasicTheme *theme);
 
+    //colors of the QML theme, read only once for all the BasicTheme instances
+    QColor color(PlatformTheme::ColorSet colorSet, ColorRole role) const;
+    QColor commonColor(CommonColor color) const;
+    //built once per color set, all the themes of the set share it
+    QPalette palette(PlatformTheme::ColorSet colorSet) const;
+
+    //the same font for all the themes, pushed to them when the application font changes
+    QFont defaultFont() const;
+    void registerTheme(BasicTheme *theme);
+    void unregisterTheme(BasicTheme *theme);
+
     QTimer *m_colorSyncTimer;
 
 private:
+    void readColors();
+    void updateDefaultFont();
+
     QUrl m_qmlPath;
     QObject *m_declarativeBasicTheme = nullptr;
+    QColor m_colors[PlatformTheme::Complementary + 1][ColorRoleCount];
+    QColor m_commonColors[CommonColorCount];
+    QPalette m_palettes[PlatformTheme::Complementary + 1];
+    QFont m_defaultFont;
+    QSet<BasicTheme *> m_themes;
 };
 
 class BasicTheme : public PlatformTheme
@@ -65,6 +109,7 @@ public:
     ~BasicTheme();
 
     void syncColors();
+    void syncFont();
 
     QColor buttonTextColor() const;
     QColor buttonBackgroundColor() const;
@@ -80,17 +125,6 @@ public:
 
 Q_SIGNALS:
     void colorsChanged();
-
-private:
-    //legacy colors
-    QColor m_buttonTextColor;
-    QColor m_buttonBackgroundColor;
-    QColor m_buttonHoverColor;
-    QColor m_buttonFocusColor;
-    QColor m_viewTextColor;
-    QColor m_viewBackgroundColor;
-    QColor m_viewHoverColor;
-    QColor m_viewFocusColor;
 };
 
 }
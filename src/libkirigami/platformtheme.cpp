@@ -18,6 +18,7 @@
 */
 
 #include "platformtheme.h"
+#include "platformtheme_p.h"
 #include "kirigamipluginfactory.h"
 #include "basictheme_p.h"
 #include <QQmlEngine>
@@ -28,25 +29,32 @@
 #include <QQuickWindow>
 #include <QPluginLoader>
 #include <QDir>
-#include <QTimer>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSharedData>
+#include <QStandardPaths>
 #include <QQuickStyle>
 
 namespace Kirigami {
 
-class PlatformThemePrivate {
+/*
+ * The resolved colors, font and palette of a theme. Themes with the same
+ * values, most commonly all the ones of the same color set, share the very
+ * same instance: once shared, a block is never modified, themes get a copy
+ * of it before changing anything.
+ */
+class PlatformThemeData : public QSharedData
+{
 public:
-    PlatformThemePrivate(PlatformTheme *q);
-    ~PlatformThemePrivate();
+    PlatformThemeData()
+    {}
+    PlatformThemeData(const PlatformThemeData &other);
+    ~PlatformThemeData();
 
-    void findParentStyle();
-    static QColor tint(const QColor &c1, const QColor &c2, qreal ratio);
-
-
-    PlatformTheme *q;
-    QTimer *setColorCompressTimer;
-    PlatformTheme::ColorSet m_colorSet = PlatformTheme::Window;
-    QSet<PlatformTheme *> m_childThemes;
-    QPointer<PlatformTheme> m_parentTheme;
+    bool operator==(const PlatformThemeData &other) const;
+    uint hash() const;
 
     QColor textColor;
     QColor disabledTextColor;
@@ -66,38 +74,300 @@ public:
 
     QFont font;
     QPalette palette;
+
+    //it's in the pool, so it can be shared with other themes
+    bool shared = false;
+};
+
+/*
+ * All the shared PlatformThemeData blocks, by content.
+ * Themes live in the GUI thread only, so there is no locking.
+ */
+class PlatformThemeDataPool
+{
+private:
+    //declared first so it's destroyed last: empty can be in it, and removes itself when destroyed
+    QMultiHash<uint, PlatformThemeData *> m_blocks;
+
+public:
+    QExplicitlySharedDataPointer<PlatformThemeData> share(const QExplicitlySharedDataPointer<PlatformThemeData> &data);
+    void remove(PlatformThemeData *data);
+
+    QExplicitlySharedDataPointer<PlatformThemeData> empty = QExplicitlySharedDataPointer<PlatformThemeData>(new PlatformThemeData);
+};
+
+Q_GLOBAL_STATIC(PlatformThemeDataPool, s_themeDataPool)
+
+PlatformThemeData::PlatformThemeData(const PlatformThemeData &other)
+    : QSharedData(other),
+      textColor(other.textColor),
+      disabledTextColor(other.disabledTextColor),
+      highlightedTextColor(other.highlightedTextColor),
+      activeTextColor(other.activeTextColor),
+      linkColor(other.linkColor),
+      visitedLinkColor(other.visitedLinkColor),
+      negativeTextColor(other.negativeTextColor),
+      neutralTextColor(other.neutralTextColor),
+      positiveTextColor(other.positiveTextColor),
+      backgroundColor(other.backgroundColor),
+      highlightColor(other.highlightColor),
+      focusColor(other.focusColor),
+      hoverColor(other.hoverColor),
+      font(other.font),
+      palette(other.palette),
+      shared(false)
+{}
+
+PlatformThemeData::~PlatformThemeData()
+{
+    if (shared && !s_themeDataPool.isDestroyed()) {
+        s_themeDataPool->remove(this);
+    }
+}
+
+bool PlatformThemeData::operator==(const PlatformThemeData &other) const
+{
+    return textColor == other.textColor
+        && disabledTextColor == other.disabledTextColor
+        && highlightedTextColor == other.highlightedTextColor
+        && activeTextColor == other.activeTextColor
+        && linkColor == other.linkColor
+        && visitedLinkColor == other.visitedLinkColor
+        && negativeTextColor == other.negativeTextColor
+        && neutralTextColor == other.neutralTextColor
+        && positiveTextColor == other.positiveTextColor
+        && backgroundColor == other.backgroundColor
+        && highlightColor == other.highlightColor
+        && focusColor == other.focusColor
+        && hoverColor == other.hoverColor
+        && font == other.font
+        && palette == other.palette;
+}
+
+uint PlatformThemeData::hash() const
+{
+    //the palette is left out, it's compared only on collisions
+    uint h = qHash(font);
+    for (const QColor *color : {&textColor, &disabledTextColor, &highlightedTextColor, &activeTextColor,
+                                &linkColor, &visitedLinkColor, &negativeTextColor, &neutralTextColor,
+                                &positiveTextColor, &backgroundColor, &highlightColor, &focusColor, &hoverColor}) {
+        h = 31 * h + color->rgba();
+    }
+    return h;
+}
+
+QExplicitlySharedDataPointer<PlatformThemeData> PlatformThemeDataPool::share(const QExplicitlySharedDataPointer<PlatformThemeData> &data)
+{
+    if (data->shared) {
+        return data;
+    }
+
+    const uint hash = data->hash();
+    for (auto it = m_blocks.constFind(hash); it != m_blocks.constEnd() && it.key() == hash; ++it) {
+        if (*it.value() == *data) {
+            return QExplicitlySharedDataPointer<PlatformThemeData>(it.value());
+        }
+    }
+
+    data->shared = true;
+    m_blocks.insert(hash, data.data());
+    return data;
+}
+
+void PlatformThemeDataPool::remove(PlatformThemeData *data)
+{
+    m_blocks.remove(data->hash(), data);
+}
+
+class PlatformThemePrivate;
+
+/*
+ * Collects the themes which colors changed, to emit colorsChanged only once
+ * for each of them on the next event loop iteration, no matter how many
+ * colors changed in the meantime.
+ * Themes live in the GUI thread only, as this object does.
+ */
+class ColorsChangedNotifier : public QObject
+{
+public:
+    void schedule(PlatformThemePrivate *theme);
+    void cancel(PlatformThemePrivate *theme);
+
+protected:
+    void customEvent(QEvent *event) Q_DECL_OVERRIDE;
+
+private:
+    QVector<PlatformThemePrivate *> m_themes;
+    //the ones being notified right now
+    QVector<PlatformThemePrivate *> m_notifying;
+    bool m_posted = false;
+};
+
+Q_GLOBAL_STATIC(ColorsChangedNotifier, s_colorsChangedNotifier)
+
+class PlatformThemePrivate {
+public:
+    PlatformThemePrivate(PlatformTheme *q);
+    ~PlatformThemePrivate();
+
+    void setParentTheme(PlatformTheme *parentTheme);
+    //sets the color set of the theme and of all the inheriting ones under it
+    void applyColorSet(PlatformTheme::ColorSet colorSet);
+    static QColor tint(const QColor &c1, const QColor &c2, qreal ratio);
+
+    //the data to be modified, never shared with other themes
+    PlatformThemeData *writableData();
+    //looks for an identical block to share once done with the changes
+    void shareData();
+
+    PlatformTheme *q;
+    PlatformTheme::ColorSet m_colorSet = PlatformTheme::Window;
+    QSet<PlatformTheme *> m_childThemes;
+    QPointer<PlatformTheme> m_parentTheme;
+
+    QExplicitlySharedDataPointer<PlatformThemeData> data;
     bool m_inherit = true;
+    //waiting for colorsChanged in ColorsChangedNotifier
+    bool m_colorsChangedScheduled = false;
 };
 
+void ColorsChangedNotifier::schedule(PlatformThemePrivate *theme)
+{
+    if (theme->m_colorsChangedScheduled) {
+        return;
+    }
+    theme->m_colorsChangedScheduled = true;
+    m_themes.append(theme);
+
+    if (!m_posted) {
+        m_posted = true;
+        QCoreApplication::postEvent(this, new QEvent(QEvent::User));
+    }
+}
+
+void ColorsChangedNotifier::cancel(PlatformThemePrivate *theme)
+{
+    if (theme->m_colorsChangedScheduled) {
+        m_themes.removeOne(theme);
+    }
+    //deleted by a colorsChanged handler
+    if (!m_notifying.isEmpty()) {
+        const int index = m_notifying.indexOf(theme);
+        if (index >= 0) {
+            m_notifying[index] = Q_NULLPTR;
+        }
+    }
+}
+
+void ColorsChangedNotifier::customEvent(QEvent *event)
+{
+    Q_UNUSED(event)
+
+    m_posted = false;
+    //themes changed by the signal handlers will be notified on the next round
+    m_notifying.swap(m_themes);
+
+    for (int i = 0; i < m_notifying.count(); ++i) {
+        PlatformThemePrivate *theme = m_notifying.at(i);
+        if (!theme) {
+            continue;
+        }
+        theme->m_colorsChangedScheduled = false;
+        theme->shareData();
+        emit theme->q->colorsChanged();
+    }
+    m_notifying.clear();
+}
+
 PlatformThemePrivate::PlatformThemePrivate(PlatformTheme *q)
-    : q(q)
+    : q(q),
+      data(s_themeDataPool->empty)
+{
+}
+
+PlatformThemeData *PlatformThemePrivate::writableData()
+{
+    if (data->shared || data->ref.load() > 1) {
+        data = QExplicitlySharedDataPointer<PlatformThemeData>(new PlatformThemeData(*data));
+    }
+    return data.data();
+}
+
+void PlatformThemePrivate::shareData()
 {
-    setColorCompressTimer = new QTimer(q);
-    setColorCompressTimer->setSingleShot(true);
-    setColorCompressTimer->setInterval(0);
+    data = s_themeDataPool->share(data);
 }
 
 PlatformThemePrivate::~PlatformThemePrivate()
 {}
 
-void PlatformThemePrivate::findParentStyle()
+/*
+ * The nearest theme attached to @p item or to one of its ancestors.
+ * This walks the ancestors, so it's called only when the item of a theme
+ * changes parent or window: themes then keep a pointer to their parent theme,
+ * which is all the inheritance needs.
+ * Reparenting an ancestor of the item rather than the item itself isn't
+ * noticed, as it wasn't before.
+ */
+static PlatformTheme *nearestTheme(QQuickItem *item)
+{
+    for (QQuickItem *candidate = item; candidate; candidate = candidate->parentItem()) {
+        if (PlatformTheme *theme = static_cast<PlatformTheme *>(qmlAttachedPropertiesObject<PlatformTheme>(candidate, false))) {
+            return theme;
+        }
+    }
+    return Q_NULLPTR;
+}
+
+void PlatformThemePrivate::setParentTheme(PlatformTheme *parentTheme)
 {
+    if (m_parentTheme == parentTheme) {
+        return;
+    }
+
     if (m_parentTheme) {
         m_parentTheme->d->m_childThemes.remove(q);
     }
-    QQuickItem *candidate = qobject_cast<QQuickItem *>(q->parent());
-    while (candidate) {
-        candidate = candidate->parentItem();
-        PlatformTheme *t = static_cast<PlatformTheme *>(qmlAttachedPropertiesObject<PlatformTheme>(candidate, false));
-        if (t) {
-            t->d->m_childThemes.insert(q);
-            m_parentTheme = t;
-            if (m_inherit) {
-                q->setColorSet(t->colorSet());
+    m_parentTheme = parentTheme;
+
+    if (parentTheme) {
+        parentTheme->d->m_childThemes.insert(q);
+        if (m_inherit) {
+            //a new theme starts from the block of the theme it inherits from: it's most likely
+            //what it will end up with, and setting the same values again changes nothing
+            if (data == s_themeDataPool->empty && !m_colorsChangedScheduled) {
+                data = parentTheme->d->data;
             }
-            break;
+            applyColorSet(parentTheme->colorSet());
+        }
+    }
+}
+
+void PlatformThemePrivate::applyColorSet(PlatformTheme::ColorSet colorSet)
+{
+    if (m_colorSet == colorSet) {
+        return;
+    }
+    m_colorSet = colorSet;
+
+    //update the whole subtree breadth first, without emitting anything yet
+    QVector<QPointer<PlatformTheme> > changed;
+    changed << q;
+    for (int i = 0; i < changed.count(); ++i) {
+        for (PlatformTheme *child : changed.at(i)->d->m_childThemes) {
+            if (child->d->m_inherit && child->d->m_colorSet != colorSet) {
+                child->d->m_colorSet = colorSet;
+                changed << child;
+            }
+        }
+    }
+
+    //handlers may delete some of the themes
+    for (const QPointer<PlatformTheme> &theme : changed) {
+        if (theme) {
+            emit theme->colorSetChanged(colorSet);
+            s_colorsChangedNotifier->schedule(theme->d);
         }
-        
     }
 }
 
@@ -117,16 +387,14 @@ PlatformTheme::PlatformTheme(QObject *parent)
     : QObject(parent),
       d(new PlatformThemePrivate(this))
 {
-    connect(d->setColorCompressTimer, &QTimer::timeout,
-            this, &PlatformTheme::colorsChanged);
-    d->findParentStyle();
-
     if (QQuickItem *item = qobject_cast<QQuickItem *>(parent)) {
-        connect(item, &QQuickItem::windowChanged, this, [this]() {
-            d->findParentStyle();
+        d->setParentTheme(nearestTheme(item->parentItem()));
+
+        connect(item, &QQuickItem::windowChanged, this, [this, item]() {
+            d->setParentTheme(nearestTheme(item->parentItem()));
         });
-        connect(item, &QQuickItem::parentChanged, this, [this]() {
-            d->findParentStyle();
+        connect(item, &QQuickItem::parentChanged, this, [this, item]() {
+            d->setParentTheme(nearestTheme(item->parentItem()));
         });
     }
     //TODO: needs https://codereview.qt-project.org/#/c/206889/ for font changes
@@ -134,27 +402,31 @@ PlatformTheme::PlatformTheme(QObject *parent)
 
 PlatformTheme::~PlatformTheme()
 {
+    if (!s_colorsChangedNotifier.isDestroyed()) {
+        s_colorsChangedNotifier->cancel(d);
+    }
     if (d->m_parentTheme) {
         d->m_parentTheme->d->m_childThemes.remove(this);
     }
-}
-
-void PlatformTheme::setColorSet(PlatformTheme::ColorSet colorSet)
-{
-    if (d->m_colorSet == colorSet) {
-        return;
+    //the children now belong to the theme above this one
+    QVector<QPointer<PlatformTheme> > children;
+    for (PlatformTheme *child : d->m_childThemes) {
+        child->d->m_parentTheme = Q_NULLPTR;
+        children << child;
     }
-
-    d->m_colorSet = colorSet;
-
-    for (PlatformTheme *t : d->m_childThemes) {
-        if (t->inherit()) {
-            t->setColorSet(colorSet);
+    d->m_childThemes.clear();
+    //colorSetChanged handlers may delete some of them
+    for (const QPointer<PlatformTheme> &child : children) {
+        if (child) {
+            child->d->setParentTheme(d->m_parentTheme);
         }
     }
+    delete d;
+}
 
-    emit colorSetChanged(colorSet);
-    d->setColorCompressTimer->start();
+void PlatformTheme::setColorSet(PlatformTheme::ColorSet colorSet)
+{
+    d->applyColorSet(colorSet);
 }
 
 PlatformTheme::ColorSet PlatformTheme::colorSet() const
@@ -183,230 +455,243 @@ void PlatformTheme::setInherit(bool inherit)
 
 QColor PlatformTheme::textColor() const
 {
-    return d->textColor;
+    return d->data->textColor;
 }
 
 QColor PlatformTheme::disabledTextColor() const
 {
-    return d->disabledTextColor;
+    return d->data->disabledTextColor;
 }
 
 QColor PlatformTheme::highlightColor() const
 {
-    return d->highlightColor;
+    return d->data->highlightColor;
 }
 
 QColor PlatformTheme::highlightedTextColor() const
 {
-    return d->highlightedTextColor;
+    return d->data->highlightedTextColor;
 }
 
 QColor PlatformTheme::backgroundColor() const
 {
-    return d->backgroundColor;
+    return d->data->backgroundColor;
 }
 
 QColor PlatformTheme::activeTextColor() const
 {
-    return d->activeTextColor;
+    return d->data->activeTextColor;
 }
 
 QColor PlatformTheme::linkColor() const
 {
-    return d->linkColor;
+    return d->data->linkColor;
 }
 
 QColor PlatformTheme::visitedLinkColor() const
 {
-    return d->visitedLinkColor;
+    return d->data->visitedLinkColor;
 }
 
 QColor PlatformTheme::negativeTextColor() const
 {
-    return d->negativeTextColor;
+    return d->data->negativeTextColor;
 }
 
 QColor PlatformTheme::neutralTextColor() const
 {
-    return d->neutralTextColor;
+    return d->data->neutralTextColor;
 }
 
 QColor PlatformTheme::positiveTextColor() const
 {
-    return d->positiveTextColor;
+    return d->data->positiveTextColor;
 }
 
 QColor PlatformTheme::focusColor() const
 {
-    return d->focusColor;
+    return d->data->focusColor;
 }
 
 QColor PlatformTheme::hoverColor() const
 {
-    return d->hoverColor;
+    return d->data->hoverColor;
 }
 
 
 void PlatformTheme::setTextColor(const QColor &color)
 {
-    if (d->textColor == color) {
+    if (d->data->textColor == color) {
         return;
     }
 
-    d->textColor = color;
-    d->setColorCompressTimer->start();
+    d->writableData()->textColor = color;
+    s_colorsChangedNotifier->schedule(d);
 }
 
 void PlatformTheme::setDisabledTextColor(const QColor &color)
 {
-    if (d->disabledTextColor == color) {
+    if (d->data->disabledTextColor == color) {
         return;
     }
 
-    d->disabledTextColor = color;
-    d->setColorCompressTimer->start();
+    d->writableData()->disabledTextColor = color;
+    s_colorsChangedNotifier->schedule(d);
 }
 
 void PlatformTheme::setBackgroundColor(const QColor &color)
 {
-    if (d->backgroundColor == color) {
+    if (d->data->backgroundColor == color) {
         return;
     }
 
-    d->backgroundColor = color;
-    d->setColorCompressTimer->start();
+    d->writableData()->backgroundColor = color;
+    s_colorsChangedNotifier->schedule(d);
 }
 
 void PlatformTheme::setHighlightColor(const QColor &color)
 {
-    if (d->highlightColor == color) {
+    if (d->data->highlightColor == color) {
         return;
     }
 
-    d->highlightColor = color;
-    d->setColorCompressTimer->start();
+    d->writableData()->highlightColor = color;
+    s_colorsChangedNotifier->schedule(d);
 }
 
 void PlatformTheme::setHighlightedTextColor(const QColor &color)
 {
-    if (d->highlightedTextColor == color) {
+    if (d->data->highlightedTextColor == color) {
         return;
     }
 
-    d->highlightedTextColor = color;
-    d->setColorCompressTimer->start();
+    d->writableData()->highlightedTextColor = color;
+    s_colorsChangedNotifier->schedule(d);
 }
 
 void PlatformTheme::setActiveTextColor(const QColor &color)
 {
-    if (d->activeTextColor == color) {
+    if (d->data->activeTextColor == color) {
         return;
     }
 
-    d->activeTextColor = color;
-    d->setColorCompressTimer->start();
+    d->writableData()->activeTextColor = color;
+    s_colorsChangedNotifier->schedule(d);
 }
 
 void PlatformTheme::setLinkColor(const QColor &color)
 {
-    if (d->linkColor == color) {
+    if (d->data->linkColor == color) {
         return;
     }
 
-    d->linkColor = color;
-    d->setColorCompressTimer->start();
+    d->writableData()->linkColor = color;
+    s_colorsChangedNotifier->schedule(d);
 }
 
 void PlatformTheme::setVisitedLinkColor(const QColor &color)
 {
-    if (d->visitedLinkColor == color) {
+    if (d->data->visitedLinkColor == color) {
         return;
     }
 
-    d->visitedLinkColor = color;
-    d->setColorCompressTimer->start();
+    d->writableData()->visitedLinkColor = color;
+    s_colorsChangedNotifier->schedule(d);
 }
 
 void PlatformTheme::setNegativeTextColor(const QColor &color)
 {
-    if (d->negativeTextColor == color) {
+    if (d->data->negativeTextColor == color) {
         return;
     }
 
-    d->negativeTextColor = color;
-    d->setColorCompressTimer->start();
+    d->writableData()->negativeTextColor = color;
+    s_colorsChangedNotifier->schedule(d);
 }
 
 void PlatformTheme::setNeutralTextColor(const QColor &color)
 {
-    if (d->neutralTextColor == color) {
+    if (d->data->neutralTextColor == color) {
         return;
     }
 
-    d->neutralTextColor = color;
-    d->setColorCompressTimer->start();
+    d->writableData()->neutralTextColor = color;
+    s_colorsChangedNotifier->schedule(d);
 }
 
 void PlatformTheme::setPositiveTextColor(const QColor &color)
 {
-    if (d->positiveTextColor == color) {
+    if (d->data->positiveTextColor == color) {
         return;
     }
 
-    d->positiveTextColor = color;
-    d->setColorCompressTimer->start();
+    d->writableData()->positiveTextColor = color;
+    s_colorsChangedNotifier->schedule(d);
 }
 
 void PlatformTheme::setHoverColor(const QColor &color)
 {
-    if (d->hoverColor == color) {
+    if (d->data->hoverColor == color) {
         return;
     }
 
-    d->hoverColor = color;
-    d->setColorCompressTimer->start();
+    d->writableData()->hoverColor = color;
+    s_colorsChangedNotifier->schedule(d);
 }
 
 void PlatformTheme::setFocusColor(const QColor &color)
 {
-    if (d->focusColor == color) {
+    if (d->data->focusColor == color) {
         return;
     }
 
-    d->focusColor = color;
-    d->setColorCompressTimer->start();
+    d->writableData()->focusColor = color;
+    s_colorsChangedNotifier->schedule(d);
 }
 
 QFont PlatformTheme::defaultFont() const
 {
-    return d->font;
+    return d->data->font;
 }
 
 void PlatformTheme::setDefaultFont(const QFont &font)
 {
-    if (d->font == font) {
+    if (d->data->font == font) {
         return;
     }
 
-    d->font = font;
+    d->writableData()->font = font;
+    //otherwise done along with the colors
+    if (!d->m_colorsChangedScheduled) {
+        d->shareData();
+    }
     emit defaultFontChanged(font);
 }
 
 QPalette PlatformTheme::palette() const
 {
-    return d->palette;
+    return d->data->palette;
 }
 
 void PlatformTheme::setPalette(const QPalette &palette)
 {
-    if (d->palette == palette) {
+    if (d->data->palette == palette) {
         return;
     }
 
-    d->palette = palette;
+    d->writableData()->palette = palette;
+    //otherwise done along with the colors
+    if (!d->m_colorsChangedScheduled) {
+        d->shareData();
+    }
     emit paletteChanged(palette);
 }
 
+const void *platformThemeDataBlock(const PlatformTheme *theme)
+{
+    return theme->d->data.data();
+}
+
 QIcon PlatformTheme::iconFromTheme(const QString &name, const QColor &customColor)
 {
     QIcon icon = QIcon::fromTheme(name);
@@ -418,25 +703,125 @@ QIcon PlatformTheme::iconFromTheme(const QString &name, const QColor &customColo
 
 
 
-PlatformTheme *PlatformTheme::qmlAttachedProperties(QObject *object)
+/*
+ * Finds the plugins providing a PlatformTheme implementation only once per
+ * process, and their factory only once per style.
+ * If the environment variable KIRIGAMI_PLUGIN_INDEX is set to 1, the list of
+ * plugin files is also saved on disk, so the next runs don't have to list
+ * the plugin directories as long as their modification time is the same.
+ */
+class PluginRegistry
+{
+public:
+    PluginRegistry();
+
+    KirigamiPluginFactory *factoryForStyle(const QString &style);
+
+private:
+    void findPlugins();
+
+    bool m_indexEnabled;
+    bool m_pluginsFound = false;
+    QStringList m_pluginFiles;
+    //null when no plugin is there for the style
+    QHash<QString, KirigamiPluginFactory *> m_factories;
+};
+
+Q_GLOBAL_STATIC(PluginRegistry, s_pluginRegistry)
+
+PluginRegistry::PluginRegistry()
+{
+    const QString env = QString::fromLatin1(qgetenv("KIRIGAMI_PLUGIN_INDEX"));
+    m_indexEnabled = (env == QStringLiteral("1") || env == QStringLiteral("true"))
+        && !QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation).isEmpty();
+}
+
+void PluginRegistry::findPlugins()
 {
+    if (m_pluginsFound) {
+        return;
+    }
+    m_pluginsFound = true;
+
+    QStringList dirs;
+    QByteArray stamp;
     for (const QString &path : QCoreApplication::libraryPaths()) {
-        QDir dir(path + "/kf5/kirigami");
-        for (const QString &fileName : dir.entryList(QDir::Files)) {
-            //TODO: env variable?
-            if (fileName.startsWith(QQuickStyle::name())) {
-                QPluginLoader loader(dir.absoluteFilePath(fileName));
-                QObject *plugin = loader.instance();
-                //TODO: load actually a factory as plugin
-
-                KirigamiPluginFactory *factory = qobject_cast<KirigamiPluginFactory *>(plugin);
-                if (factory) {
-                    return factory->createPlatformTheme(object);
+        const QFileInfo info(path + QStringLiteral("/kf5/kirigami"));
+        dirs << info.absoluteFilePath();
+        //adding or removing a plugin changes the modification time of its directory
+        stamp += info.absoluteFilePath().toUtf8() + ' '
+            + (info.exists() ? QByteArray::number(info.lastModified().toMSecsSinceEpoch()) : QByteArray("-")) + ';';
+    }
+
+    QString indexPath;
+    if (m_indexEnabled) {
+        indexPath = QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + QStringLiteral("/kirigami/plugins.index");
+        QFile index(indexPath);
+        if (index.open(QIODevice::ReadOnly) && index.readLine().trimmed() == stamp) {
+            while (!index.atEnd()) {
+                const QString file = QString::fromUtf8(index.readLine().trimmed());
+                if (!file.isEmpty()) {
+                    m_pluginFiles << file;
                 }
             }
+            return;
         }
     }
 
+    for (const QString &path : dirs) {
+        QDir dir(path);
+        for (const QString &fileName : dir.entryList(QDir::Files)) {
+            m_pluginFiles << dir.absoluteFilePath(fileName);
+        }
+    }
+
+    if (!indexPath.isEmpty()) {
+        QDir().mkpath(QFileInfo(indexPath).absolutePath());
+        QSaveFile index(indexPath);
+        if (index.open(QIODevice::WriteOnly)) {
+            index.write(stamp + '\n');
+            for (const QString &file : m_pluginFiles) {
+                index.write(file.toUtf8() + '\n');
+            }
+            index.commit();
+        }
+    }
+}
+
+KirigamiPluginFactory *PluginRegistry::factoryForStyle(const QString &style)
+{
+    auto it = m_factories.constFind(style);
+    if (it != m_factories.constEnd()) {
+        return it.value();
+    }
+
+    findPlugins();
+
+    KirigamiPluginFactory *factory = nullptr;
+    for (const QString &path : m_pluginFiles) {
+        //TODO: env variable?
+        if (!QFileInfo(path).fileName().startsWith(style)) {
+            continue;
+        }
+        //the root component stays loaded after the loader goes away
+        QPluginLoader loader(path);
+        factory = qobject_cast<KirigamiPluginFactory *>(loader.instance());
+        if (factory) {
+            break;
+        }
+    }
+
+    m_factories.insert(style, factory);
+    return factory;
+}
+
+PlatformTheme *PlatformTheme::qmlAttachedProperties(QObject *object)
+{
+    KirigamiPluginFactory *factory = s_pluginRegistry->factoryForStyle(QQuickStyle::name());
+    if (factory) {
+        return factory->createPlatformTheme(object);
+    }
+
     return new BasicTheme(object);
 }
 
@@ -225,6 +225,7 @@ protected:
 private:
     PlatformThemePrivate *d;
     friend class PlatformThemePrivate;
+    friend const void *platformThemeDataBlock(const PlatformTheme *theme);
 };
 
 }
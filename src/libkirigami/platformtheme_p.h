@@ -0,0 +1,32 @@
+/*
+*   Copyright (C) 2017 by Marco Martin <mart@kde.org>
+*
+*   This program is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU Library General Public License as
+*   published by the Free Software Foundation; either version 2, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU Library General Public License for more details
+*
+*   You should have received a copy of the GNU Library General Public
+*   License along with this program; if not, write to the
+*   Free Software Foundation, Inc.,
+*   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef PLATFORMTHEME_P_H
+#define PLATFORMTHEME_P_H
+
+#include "platformtheme.h"
+
+namespace Kirigami {
+
+//identifies the data block used by @p theme, themes sharing it return the same value; for the autotests
+KIRIGAMI2_EXPORT const void *platformThemeDataBlock(const PlatformTheme *theme);
+
+}
+
+#endif // PLATFORMTHEME_P_H
@@ -0,0 +1,192 @@
+/*
+ *   Copyright 2017 Marco Martin <mart@kde.org>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Library General Public License as
+ *   published by the Free Software Foundation; either version 2, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details
+ *
+ *   You should have received a copy of the GNU Library General Public
+ *   License along with this program; if not, write to the
+ *   Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "maskedtexturenode.h"
+
+#include <QOpenGLShaderProgram>
+#include <QSGMaterial>
+#include <QVector4D>
+
+class MaskedTextureMaterial : public QSGMaterial
+{
+public:
+    MaskedTextureMaterial()
+    {
+        setFlag(Blending, true);
+    }
+
+    QSGMaterialType *type() const Q_DECL_OVERRIDE
+    {
+        static QSGMaterialType type;
+        return &type;
+    }
+
+    QSGMaterialShader *createShader() const Q_DECL_OVERRIDE;
+
+    int compare(const QSGMaterial *other) const Q_DECL_OVERRIDE
+    {
+        const MaskedTextureMaterial *o = static_cast<const MaskedTextureMaterial *>(other);
+        //textures in the same atlas have the same id, so those icons can be batched
+        const int textureDiff = (texture ? texture->textureId() : 0) - (o->texture ? o->texture->textureId() : 0);
+        if (textureDiff != 0) {
+            return textureDiff;
+        }
+        if (color.rgba() == o->color.rgba()) {
+            return 0;
+        }
+        return color.rgba() < o->color.rgba() ? -1 : 1;
+    }
+
+    QSGTexture *texture = Q_NULLPTR;
+    QColor color;
+    QSGTexture::Filtering filtering = QSGTexture::Nearest;
+};
+
+class MaskedTextureShader : public QSGMaterialShader
+{
+public:
+    const char *vertexShader() const Q_DECL_OVERRIDE
+    {
+        return "uniform highp mat4 qt_Matrix;                       \n"
+               "attribute highp vec4 qt_VertexPosition;             \n"
+               "attribute highp vec2 qt_VertexTexCoord;             \n"
+               "varying highp vec2 qt_TexCoord;                     \n"
+               "void main() {                                       \n"
+               "    qt_TexCoord = qt_VertexTexCoord;                \n"
+               "    gl_Position = qt_Matrix * qt_VertexPosition;    \n"
+               "}";
+    }
+
+    const char *fragmentShader() const Q_DECL_OVERRIDE
+    {
+        return "uniform sampler2D qt_Texture;                       \n"
+               "uniform lowp vec4 color;                            \n"
+               "uniform lowp float qt_Opacity;                      \n"
+               "varying highp vec2 qt_TexCoord;                     \n"
+               "void main() {                                       \n"
+               "    gl_FragColor = color * (texture2D(qt_Texture, qt_TexCoord).a * qt_Opacity); \n"
+               "}";
+    }
+
+    char const *const *attributeNames() const Q_DECL_OVERRIDE
+    {
+        static const char *names[] = { "qt_VertexPosition", "qt_VertexTexCoord", Q_NULLPTR };
+        return names;
+    }
+
+    void updateState(const RenderState &state, QSGMaterial *newMaterial, QSGMaterial *oldMaterial) Q_DECL_OVERRIDE
+    {
+        MaskedTextureMaterial *material = static_cast<MaskedTextureMaterial *>(newMaterial);
+        MaskedTextureMaterial *old = static_cast<MaskedTextureMaterial *>(oldMaterial);
+
+        if (state.isMatrixDirty()) {
+            program()->setUniformValue(m_matrixId, state.combinedMatrix());
+        }
+        if (state.isOpacityDirty()) {
+            program()->setUniformValue(m_opacityId, state.opacity());
+        }
+        if (!old || old->color != material->color) {
+            //premultiplied, as everything else in the scene graph
+            const QColor &c = material->color;
+            program()->setUniformValue(m_colorId, QVector4D(c.redF() * c.alphaF(), c.greenF() * c.alphaF(),
+                                                            c.blueF() * c.alphaF(), c.alphaF()));
+        }
+        if (material->texture) {
+            material->texture->setFiltering(material->filtering);
+            material->texture->bind();
+        }
+    }
+
+protected:
+    void initialize() Q_DECL_OVERRIDE
+    {
+        m_matrixId = program()->uniformLocation("qt_Matrix");
+        m_opacityId = program()->uniformLocation("qt_Opacity");
+        m_colorId = program()->uniformLocation("color");
+    }
+
+private:
+    int m_matrixId = -1;
+    int m_opacityId = -1;
+    int m_colorId = -1;
+};
+
+QSGMaterialShader *MaskedTextureMaterial::createShader() const
+{
+    return new MaskedTextureShader;
+}
+
+MaskedTextureNode::MaskedTextureNode()
+    : m_geometry(QSGGeometry::defaultAttributes_TexturedPoint2D(), 4),
+      m_material(new MaskedTextureMaterial)
+{
+    setGeometry(&m_geometry);
+    setMaterial(m_material);
+    setFlag(OwnsMaterial, true);
+}
+
+MaskedTextureNode::~MaskedTextureNode()
+{
+}
+
+void MaskedTextureNode::setTexture(const QSharedPointer<QSGTexture> &texture)
+{
+    if (m_texture == texture) {
+        return;
+    }
+    m_texture = texture;
+    m_material->texture = texture.data();
+    //the sub rect changes for atlas textures
+    updateGeometry();
+    markDirty(DirtyMaterial);
+}
+
+void MaskedTextureNode::setColor(const QColor &color)
+{
+    if (m_material->color == color) {
+        return;
+    }
+    m_material->color = color;
+    markDirty(DirtyMaterial);
+}
+
+void MaskedTextureNode::setFiltering(QSGTexture::Filtering filtering)
+{
+    if (m_material->filtering == filtering) {
+        return;
+    }
+    m_material->filtering = filtering;
+    markDirty(DirtyMaterial);
+}
+
+void MaskedTextureNode::setRect(const QRectF &rect)
+{
+    if (m_rect == rect) {
+        return;
+    }
+    m_rect = rect;
+    updateGeometry();
+}
+
+void MaskedTextureNode::updateGeometry()
+{
+    QSGGeometry::updateTexturedRectGeometry(&m_geometry, m_rect,
+                                            m_texture ? m_texture->normalizedTextureSubRect() : QRectF(0, 0, 1, 1));
+    markDirty(DirtyGeometry);
+}
@@ -0,0 +1,61 @@
+/*
+ *   Copyright 2017 Marco Martin <mart@kde.org>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Library General Public License as
+ *   published by the Free Software Foundation; either version 2, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details
+ *
+ *   You should have received a copy of the GNU Library General Public
+ *   License along with this program; if not, write to the
+ *   Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef MASKEDTEXTURENODE_H
+#define MASKEDTEXTURENODE_H
+
+#include <QColor>
+#include <QSGGeometry>
+#include <QSGGeometryNode>
+#include <QSGTexture>
+#include <QSharedPointer>
+
+class MaskedTextureMaterial;
+
+/**
+ * Draws the alpha channel of a texture filled with a single color.
+ *
+ * Used for mask and symbolic icons: the image is rasterized and uploaded
+ * only once, while the color comes from a uniform of the material, so
+ * changing the color set or the palette doesn't touch the texture at all.
+ *
+ * It needs the OpenGL scene graph backend.
+ */
+class MaskedTextureNode : public QSGGeometryNode
+{
+Q_DISABLE_COPY(MaskedTextureNode)
+public:
+    MaskedTextureNode();
+    ~MaskedTextureNode();
+
+    void setTexture(const QSharedPointer<QSGTexture> &texture);
+    void setColor(const QColor &color);
+    void setFiltering(QSGTexture::Filtering filtering);
+    void setRect(const QRectF &rect);
+
+private:
+    void updateGeometry();
+
+    QSGGeometry m_geometry;
+    MaskedTextureMaterial *m_material;
+    QSharedPointer<QSGTexture> m_texture;
+    QRectF m_rect;
+};
+
+#endif
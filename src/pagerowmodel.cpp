@@ -0,0 +1,552 @@
+/*
+ *   Copyright 2017 Marco Martin <mart@kde.org>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Library General Public License as
+ *   published by the Free Software Foundation; either version 2, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Library General Public License for more details
+ *
+ *   You should have received a copy of the GNU Library General Public
+ *   License along with this program; if not, write to the
+ *   Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "pagerowmodel.h"
+
+#include <QDebug>
+#include <QQmlComponent>
+#include <QQmlContext>
+#include <QQmlEngine>
+#include <QQmlProperty>
+#include <QQuickItem>
+
+//an entry of an array of pages can be an object in the form {"page": page, "properties": {...}}
+static void splitPageEntry(const QVariant &entry, QVariant *page, QVariantMap *properties)
+{
+    if (entry.userType() == QMetaType::QVariantMap) {
+        const QVariantMap map = entry.toMap();
+        *page = map.value(QStringLiteral("page"));
+        *properties = map.value(QStringLiteral("properties")).toMap();
+    } else {
+        *page = entry;
+        properties->clear();
+    }
+}
+
+static void writeProperties(QObject *object, const QVariantMap &properties)
+{
+    QQmlContext *context = qmlContext(object);
+    for (auto it = properties.constBegin(); it != properties.constEnd(); ++it) {
+        QQmlProperty::write(object, it.key(), it.value(), context);
+    }
+}
+
+PageRowModel::PageRowModel(QObject *parent)
+    : QObject(parent)
+{
+}
+
+PageRowModel::~PageRowModel()
+{
+}
+
+QObject *PageRowModel::model() const
+{
+    return m_model;
+}
+
+void PageRowModel::setModel(QObject *model)
+{
+    if (model == m_model) {
+        return;
+    }
+
+    m_model = model;
+    emit modelChanged();
+}
+
+QQmlComponent *PageRowModel::delegate() const
+{
+    return m_delegate;
+}
+
+void PageRowModel::setDelegate(QQmlComponent *component)
+{
+    if (component == m_delegate) {
+        return;
+    }
+
+    m_delegate = component;
+    //pooled containers come from the old delegate
+    for (const QPointer<QQuickItem> &container : qAsConst(m_containerPool)) {
+        if (container) {
+            container->deleteLater();
+        }
+    }
+    m_containerPool.clear();
+    emit delegateChanged();
+}
+
+QQuickItem *PageRowModel::view() const
+{
+    return m_view;
+}
+
+void PageRowModel::setView(QQuickItem *view)
+{
+    if (view == m_view) {
+        return;
+    }
+
+    m_view = view;
+    emit viewChanged();
+}
+
+int PageRowModel::count() const
+{
+    return m_pages.count();
+}
+
+int PageRowModel::containerPoolSize() const
+{
+    return m_containerPoolSize;
+}
+
+void PageRowModel::setContainerPoolSize(int size)
+{
+    size = qMax(0, size);
+    if (size == m_containerPoolSize) {
+        return;
+    }
+
+    m_containerPoolSize = size;
+    while (m_containerPool.count() > m_containerPoolSize) {
+        QQuickItem *container = m_containerPool.takeLast();
+        if (container) {
+            container->deleteLater();
+        }
+    }
+    emit containerPoolSizeChanged();
+}
+
+bool PageRowModel::containsPage(const QVariant &page) const
+{
+    return indexOf(page) > -1;
+}
+
+int PageRowModel::indexOf(const QVariant &page) const
+{
+    QObject *object = page.value<QObject *>();
+    return object ? m_pageLevels.value(object, -1) : -1;
+}
+
+QQuickItem *PageRowModel::get(int level) const
+{
+    if (level < 0 || level >= m_pages.count()) {
+        return Q_NULLPTR;
+    }
+    return m_pages.at(level).container;
+}
+
+QQuickItem *PageRowModel::pageAt(int level)
+{
+    if (level < 0 || level >= m_pages.count()) {
+        return Q_NULLPTR;
+    }
+
+    loadPage(level);
+    QQuickItem *container = m_pages.at(level).container;
+    return container ? container->property("page").value<QQuickItem *>() : Q_NULLPTR;
+}
+
+QQuickItem *PageRowModel::push(const QVariant &page, const QVariantMap &properties)
+{
+    if (!m_model || !m_delegate) {
+        qWarning() << "PageRowModel: a model and a delegate are needed to push pages";
+        return Q_NULLPTR;
+    }
+
+    QVariantList pages;
+    if (page.userType() == QMetaType::QVariantList) {
+        pages = page.toList();
+    } else {
+        pages << page;
+    }
+
+    QQuickItem *container = Q_NULLPTR;
+    const int oldCount = m_pages.count();
+
+    for (int i = 0; i < pages.count(); ++i) {
+        QVariant entry;
+        QVariantMap entryProperties;
+        splitPageEntry(pages.at(i), &entry, &entryProperties);
+        if (i == pages.count() - 1 && !properties.isEmpty()) {
+            entryProperties = properties;
+        }
+
+        if (containsPage(entry)) {
+            qWarning() << "The item" << entry.value<QObject *>() << "is already in the PageRow";
+            continue;
+        }
+
+        QQmlComponent *component = componentFor(entry);
+        QQuickItem *pageItem = Q_NULLPTR;
+        if (component) {
+            pageItem = createPage(component, entryProperties);
+        } else {
+            pageItem = qobject_cast<QQuickItem *>(entry.value<QObject *>());
+            if (pageItem) {
+                writeProperties(pageItem, entryProperties);
+            } else {
+                qWarning() << "PageRow: pages can only be Items, Components or urls, got" << entry;
+            }
+        }
+        if (!pageItem) {
+            container = Q_NULLPTR;
+            break;
+        }
+
+        const int level = m_pages.count();
+        container = createContainer(level);
+        if (!container) {
+            if (component) {
+                pageItem->deleteLater();
+            }
+            break;
+        }
+
+        //the container takes the page, pages that weren't created by us go back to their parent once popped
+        QQuickItem *owner = component ? Q_NULLPTR : pageItem->parentItem();
+        container->setProperty("page", QVariant::fromValue(pageItem));
+        container->setProperty("owner", QVariant::fromValue(owner));
+
+        PageEntry pageEntry;
+        pageEntry.container = container;
+        pageEntry.component = component;
+        pageEntry.ownerLevels << owningLevelOf(component ? static_cast<QObject *>(component) : pageItem);
+        for (auto it = entryProperties.constBegin(); it != entryProperties.constEnd(); ++it) {
+            QObject *object = it.value().value<QObject *>();
+            if (object) {
+                //unloading the page the object belongs to would destroy it under our feet
+                pageEntry.ownerLevels << owningLevelOf(object);
+            }
+            if (!component) {
+                continue;
+            } else if (object) {
+                pageEntry.objectProperties.insert(it.key(), object);
+            } else {
+                pageEntry.properties.insert(it.key(), it.value());
+            }
+        }
+        for (int ownerLevel : pageEntry.ownerLevels) {
+            if (ownerLevel > -1) {
+                ++m_pages[ownerLevel].children;
+            }
+        }
+
+        m_pages.append(pageEntry);
+        m_pageLevels.insert(pageItem, level);
+        connect(pageItem, &QObject::destroyed, this, &PageRowModel::pageDestroyed);
+        QMetaObject::invokeMethod(m_model, "append", Q_ARG(QObject *, container));
+    }
+
+    if (m_pages.count() != oldCount) {
+        emit countChanged();
+    }
+
+    return container;
+}
+
+void PageRowModel::removeFrom(int level)
+{
+    level = qMax(0, level);
+    const int oldCount = m_pages.count();
+    if (level >= oldCount) {
+        return;
+    }
+
+    const QVector<PageEntry> removed = m_pages.mid(level);
+    m_pages.resize(level);
+    for (const PageEntry &entry : removed) {
+        for (int ownerLevel : entry.ownerLevels) {
+            if (ownerLevel > -1 && ownerLevel < level) {
+                --m_pages[ownerLevel].children;
+            }
+        }
+    }
+
+    //a single change for the whole range, so the view relayouts just once
+    if (m_model) {
+        QMetaObject::invokeMethod(m_model, "remove", Q_ARG(int, level), Q_ARG(int, oldCount - level));
+    }
+    //the view must be done with the containers before they can be pushed again
+    if (m_containerPool.count() < m_containerPoolSize && m_view
+        && m_view->metaObject()->indexOfMethod("forceLayout()") > -1) {
+        QMetaObject::invokeMethod(m_view, "forceLayout");
+    }
+    emit countChanged();
+
+    for (int i = removed.count() - 1; i >= 0; --i) {
+        const PageEntry &entry = removed.at(i);
+        if (entry.container) {
+            releasePage(entry);
+            releaseContainer(entry.container);
+        }
+    }
+}
+
+void PageRowModel::clear()
+{
+    removeFrom(0);
+}
+
+void PageRowModel::unloadOutside(int first, int last)
+{
+    for (int i = 0; i < m_pages.count(); ++i) {
+        if (i >= first && i <= last) {
+            loadPage(i);
+        } else if (canUnload(i)) {
+            unloadPage(i);
+        }
+    }
+}
+
+void PageRowModel::pageDestroyed(QObject *page)
+{
+    m_pageLevels.remove(page);
+}
+
+QQuickItem *PageRowModel::createContainer(int level)
+{
+    while (!m_containerPool.isEmpty()) {
+        QQuickItem *container = m_containerPool.takeLast();
+        if (container) {
+            container->setProperty("level", level);
+            container->setVisible(true);
+            return container;
+        }
+    }
+
+    QQmlContext *context = m_delegate->creationContext();
+    if (!context) {
+        context = qmlContext(this);
+    }
+
+    QObject *object = m_delegate->beginCreate(context);
+    QQuickItem *container = qobject_cast<QQuickItem *>(object);
+    if (!container) {
+        if (object) {
+            m_delegate->completeCreate();
+            delete object;
+        }
+        qWarning() << "PageRowModel: could not create a page container" << m_delegate->errors();
+        return Q_NULLPTR;
+    }
+
+    container->setParent(m_view.data());
+    container->setParentItem(m_view);
+    container->setProperty("level", level);
+    m_delegate->completeCreate();
+
+    return container;
+}
+
+QQmlComponent *PageRowModel::componentFor(const QVariant &page)
+{
+    if (QObject *object = page.value<QObject *>()) {
+        return qobject_cast<QQmlComponent *>(object);
+    }
+
+    QUrl url;
+    if (page.userType() == QMetaType::QString) {
+        url = QUrl(page.toString());
+    } else if (page.userType() == QMetaType::QUrl) {
+        url = page.toUrl();
+    } else {
+        return Q_NULLPTR;
+    }
+
+    //relative urls are resolved from PageRow.qml, as Qt.createComponent() did
+    QQmlContext *context = qmlContext(this);
+    const QUrl resolved = context ? context->resolvedUrl(url) : url;
+
+    QQmlComponent *component = m_componentCache.value(resolved);
+    if (component) {
+        return component;
+    }
+
+    QQmlEngine *engine = qmlEngine(this);
+    if (!engine) {
+        return Q_NULLPTR;
+    }
+
+    component = new QQmlComponent(engine, resolved, this);
+    m_componentCache.insert(resolved, component);
+    return component;
+}
+
+QQuickItem *PageRowModel::createPage(QQmlComponent *component, const QVariantMap &properties)
+{
+    if (component->status() != QQmlComponent::Ready) {
+        qWarning() << "Error while loading page:" << component->errorString();
+        return Q_NULLPTR;
+    }
+
+    QQmlContext *context = component->creationContext();
+    if (!context) {
+        context = qmlContext(this);
+    }
+
+    QObject *object = component->beginCreate(context);
+    QQuickItem *item = qobject_cast<QQuickItem *>(object);
+    if (item) {
+        //owned by the view, not left to the garbage collector; they still get deleted as soon as popped
+        item->setParent(m_view.data());
+        writeProperties(item, properties);
+    }
+    if (object) {
+        component->completeCreate();
+    }
+    if (!item) {
+        delete object;
+        qWarning() << "Error while loading page:" << component->errorString();
+        return Q_NULLPTR;
+    }
+
+    return item;
+}
+
+int PageRowModel::owningLevelOf(QObject *object) const
+{
+    //a page of the stack, or anything declared inside one, such as a component or another page
+    for (QObject *parent = object; parent; parent = parent->parent()) {
+        auto it = m_pageLevels.constFind(parent);
+        if (it != m_pageLevels.constEnd()) {
+            return it.value();
+        }
+    }
+    return -1;
+}
+
+bool PageRowModel::canUnload(int level) const
+{
+    const PageEntry &entry = m_pages.at(level);
+    return !entry.unloaded && entry.component && entry.container && entry.children == 0
+        && level < m_pages.count() - 1;
+}
+
+void PageRowModel::loadPage(int level)
+{
+    const PageEntry entry = m_pages.at(level);
+    if (!entry.unloaded || !entry.container) {
+        return;
+    }
+    if (!entry.component) {
+        qWarning() << "PageRowModel: the component of the page at level" << level << "is gone, it can't be loaded again";
+        return;
+    }
+
+    QVariantMap properties = entry.properties;
+    for (auto it = entry.objectProperties.constBegin(); it != entry.objectProperties.constEnd(); ++it) {
+        if (it.value()) {
+            properties.insert(it.key(), QVariant::fromValue(it.value().data()));
+        }
+    }
+
+    QQuickItem *page = createPage(entry.component, properties);
+    if (!page) {
+        return;
+    }
+    //the page may have changed the stack while being created
+    if (level >= m_pages.count() || m_pages.at(level).container != entry.container) {
+        page->deleteLater();
+        return;
+    }
+
+    m_pages[level].unloaded = false;
+    m_pages[level].state = QVariant();
+    m_pageLevels.insert(page, level);
+    connect(page, &QObject::destroyed, this, &PageRowModel::pageDestroyed);
+
+    entry.container->setProperty("page", QVariant::fromValue(page));
+    entry.container->setProperty("owner", QVariant::fromValue<QQuickItem *>(Q_NULLPTR));
+    entry.container->setProperty("unloaded", false);
+
+    if (entry.state.isValid() && page->metaObject()->indexOfMethod("restoreState(QVariant)") > -1) {
+        QMetaObject::invokeMethod(page, "restoreState", Q_ARG(QVariant, entry.state));
+    }
+}
+
+void PageRowModel::unloadPage(int level)
+{
+    QQuickItem *container = m_pages.at(level).container;
+    QQuickItem *page = container->property("page").value<QQuickItem *>();
+    if (!page) {
+        return;
+    }
+
+    QVariant state;
+    if (page->metaObject()->indexOfMethod("saveState()") > -1) {
+        QMetaObject::invokeMethod(page, "saveState", Q_RETURN_ARG(QVariant, state));
+    }
+    if (level >= m_pages.count() || m_pages.at(level).container != container) {
+        return;
+    }
+
+    m_pages[level].state = state;
+    m_pages[level].unloaded = true;
+    m_pageLevels.remove(page);
+    disconnect(page, &QObject::destroyed, this, &PageRowModel::pageDestroyed);
+
+    //the container stays as a placeholder, so the row keeps its layout
+    container->setProperty("unloaded", true);
+    container->setProperty("page", QVariant::fromValue<QQuickItem *>(Q_NULLPTR));
+
+    page->setVisible(false);
+    page->setParentItem(Q_NULLPTR);
+    page->deleteLater();
+}
+
+void PageRowModel::releasePage(const PageEntry &entry)
+{
+    QQuickItem *page = entry.container->property("page").value<QQuickItem *>();
+    QQuickItem *owner = entry.container->property("owner").value<QQuickItem *>();
+
+    if (!page) {
+        return;
+    }
+
+    m_pageLevels.remove(page);
+    disconnect(page, &QObject::destroyed, this, &PageRowModel::pageDestroyed);
+
+    if (owner) {
+        page->setVisible(false);
+        page->setParentItem(owner);
+    } else if (page->parentItem() == entry.container) {
+        //pages created by us belong to the view, which outlives their container: delete them right away
+        page->setVisible(false);
+        page->deleteLater();
+    }
+}
+
+void PageRowModel::releaseContainer(QQuickItem *container)
+{
+    container->setVisible(false);
+
+    if (m_containerPool.count() < m_containerPoolSize) {
+        container->setProperty("page", QVariant::fromValue<QQuickItem *>(Q_NULLPTR));
+        container->setProperty("owner", QVariant::fromValue<QQuickItem *>(Q_NULLPTR));
+        container->setProperty("unloaded", false);
+        m_containerPool.append(container);
+    } else {
+        container->deleteLater();
+    }
+}
+
+#include "moc_pagerowmodel.cpp"
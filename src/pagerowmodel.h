@@ -0,0 +1,191 @@
+/*
+ *   Copyright 2017 Marco Martin <mart@kde.org>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Library General Public License as
+ *   published by the Free Software Foundation; either version 2, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Library General Public License for more details
+ *
+ *   You should have received a copy of the GNU Library General Public
+ *   License along with this program; if not, write to the
+ *   Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef PAGEROWMODEL_H
+#define PAGEROWMODEL_H
+
+#include <QObject>
+#include <QHash>
+#include <QPointer>
+#include <QUrl>
+#include <QVariant>
+#include <QVector>
+
+class QQmlComponent;
+class QQuickItem;
+
+/**
+ * The stack of pages of a PageRow, internal use only.
+ *
+ * Every page is wrapped in a container item created from the delegate,
+ * and the containers are kept in sync with the ObjectModel shown by the
+ * PageRow ListView. Looking up a page is constant time, and popping any
+ * number of pages removes them from the view with a single model change.
+ *
+ * Pages created from a Component or url can be unloaded while their
+ * container stays in the view as a placeholder, and get created again
+ * once needed. Before being unloaded a page can save its state in the
+ * return value of its optional "function saveState()", which is given
+ * back to its "function restoreState(state)" once loaded again.
+ */
+class PageRowModel : public QObject
+{
+    Q_OBJECT
+
+    /**
+     * The ObjectModel the containers are shown with
+     */
+    Q_PROPERTY(QObject *model READ model WRITE setModel NOTIFY modelChanged)
+
+    /**
+     * The component the containers of the pages are created from,
+     * it must have the "level", "page" and "owner" properties
+     */
+    Q_PROPERTY(QQmlComponent *delegate READ delegate WRITE setDelegate NOTIFY delegateChanged)
+
+    /**
+     * The view showing the model, the containers get parented to it
+     */
+    Q_PROPERTY(QQuickItem *view READ view WRITE setView NOTIFY viewChanged)
+
+    /**
+     * The number of pages in the stack
+     */
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+
+    /**
+     * How many containers of popped pages are kept around to be reused
+     * by the next pushes, 0 by default
+     */
+    Q_PROPERTY(int containerPoolSize READ containerPoolSize WRITE setContainerPoolSize NOTIFY containerPoolSizeChanged)
+
+public:
+    explicit PageRowModel(QObject *parent = Q_NULLPTR);
+    ~PageRowModel();
+
+    QObject *model() const;
+    void setModel(QObject *model);
+
+    QQmlComponent *delegate() const;
+    void setDelegate(QQmlComponent *component);
+
+    QQuickItem *view() const;
+    void setView(QQuickItem *view);
+
+    int count() const;
+
+    int containerPoolSize() const;
+    void setContainerPoolSize(int size);
+
+    /**
+     * @returns true if @p page is an item already in the stack
+     */
+    Q_INVOKABLE bool containsPage(const QVariant &page) const;
+
+    /**
+     * @returns the level of @p page in the stack, -1 if it's not there
+     */
+    Q_INVOKABLE int indexOf(const QVariant &page) const;
+
+    /**
+     * @returns the container of the page at @p level
+     */
+    Q_INVOKABLE QQuickItem *get(int level) const;
+
+    /**
+     * @returns the page at @p level, loading it again if it was unloaded
+     */
+    Q_INVOKABLE QQuickItem *pageAt(int level);
+
+    /**
+     * Pushes @p page on the stack, see PageRow::push for the accepted values.
+     * When @p page is an array, all its pages get pushed, @p properties
+     * applying to the last one.
+     * @returns the container of the last page pushed, or null on error
+     */
+    Q_INVOKABLE QQuickItem *push(const QVariant &page, const QVariantMap &properties);
+
+    /**
+     * Removes the page at @p level and all the ones after it.
+     * Pages that were pushed as items go back to their original parent,
+     * the ones created by the stack are destroyed.
+     */
+    Q_INVOKABLE void removeFrom(int level);
+
+    /**
+     * Removes all the pages
+     */
+    Q_INVOKABLE void clear();
+
+    /**
+     * Makes sure the pages from @p first to @p last are loaded, and unloads
+     * all the other ones that can be.
+     * The last page, pages pushed as items and pages that other pages
+     * in the stack were created from, or were given objects of as
+     * properties, are never unloaded.
+     */
+    Q_INVOKABLE void unloadOutside(int first, int last);
+
+Q_SIGNALS:
+    void modelChanged();
+    void delegateChanged();
+    void viewChanged();
+    void countChanged();
+    void containerPoolSizeChanged();
+
+private Q_SLOTS:
+    void pageDestroyed(QObject *page);
+
+private:
+    struct PageEntry {
+        QPointer<QQuickItem> container;
+        //what the page was created from, null for pages pushed as items
+        QPointer<QQmlComponent> component;
+        //what it was created with, object values are kept apart so they can't dangle
+        QVariantMap properties;
+        QHash<QString, QPointer<QObject> > objectProperties;
+        QVariant state;
+        //levels of the pages the page, its component or its object properties belong to
+        QVector<int> ownerLevels;
+        //number of times the pages after this one depend on it, see ownerLevels
+        int children = 0;
+        bool unloaded = false;
+    };
+
+    QQuickItem *createContainer(int level);
+    QQmlComponent *componentFor(const QVariant &page);
+    QQuickItem *createPage(QQmlComponent *component, const QVariantMap &properties);
+    int owningLevelOf(QObject *object) const;
+    void loadPage(int level);
+    void unloadPage(int level);
+    bool canUnload(int level) const;
+    void releasePage(const PageEntry &entry);
+    void releaseContainer(QQuickItem *container);
+
+    QPointer<QObject> m_model;
+    QPointer<QQmlComponent> m_delegate;
+    QPointer<QQuickItem> m_view;
+    QVector<PageEntry> m_pages;
+    QHash<QObject *, int> m_pageLevels;
+    QHash<QUrl, QQmlComponent *> m_componentCache;
+    QVector<QPointer<QQuickItem> > m_containerPool;
+    int m_containerPoolSize = 0;
+};
+
+#endif
@@ -0,0 +1,360 @@
+/*
+ *   Copyright 2017 Marco Martin <mart@kde.org>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Library General Public License as
+ *   published by the Free Software Foundation; either version 2, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details
+ *
+ *   You should have received a copy of the GNU Library General Public
+ *   License along with this program; if not, write to the
+ *   Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "remoteimageloader.h"
+#include "icondiskcache.h"
+#include "iconrasterizer.h"
+
+#include <QAtomicInt>
+#include <QBuffer>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QRunnable>
+
+static const int s_maxRedirects = 10;
+//images are never kept on disk longer than this, whatever the server says
+static const int s_diskCacheMaxAgeDays = 7;
+//the remote images on disk are pruned to this size, least recently used first
+static const qint64 s_diskCacheMaxBytes = 64 * 1024 * 1024;
+//how many images are written to disk between two prunings
+static const int s_diskWritesPerPrune = 32;
+
+class ImageDecodeJob : public QRunnable
+{
+public:
+    ImageDecodeJob(RemoteImageLoader *loader, const RemoteImageKey &key, const QByteArray &data,
+                   const QString &diskCachePath, qint64 expires)
+        : m_loader(loader),
+          m_key(key),
+          m_data(data),
+          m_diskCachePath(diskCachePath),
+          m_expires(expires)
+    {}
+
+    void run() Q_DECL_OVERRIDE
+    {
+        const QImage image = RemoteImageLoader::decodeImage(m_data, m_key.size);
+        if (!m_diskCachePath.isEmpty()) {
+            IconDiskCache::save(m_diskCachePath, image, m_expires);
+        }
+        //the loader is a global static, it outlives the pool and all its jobs
+        emit m_loader->decoded(m_key.url, m_key.size, image);
+    }
+
+private:
+    RemoteImageLoader *m_loader;
+    RemoteImageKey m_key;
+    QByteArray m_data;
+    QString m_diskCachePath;
+    qint64 m_expires;
+};
+
+class DiskProbeJob : public QRunnable
+{
+public:
+    DiskProbeJob(RemoteImageLoader *loader, const RemoteImageKey &key, const QString &diskCachePath)
+        : m_loader(loader),
+          m_key(key),
+          m_diskCachePath(diskCachePath)
+    {}
+
+    void run() Q_DECL_OVERRIDE
+    {
+        qint64 expires = 0;
+        QImage image = IconDiskCache::load(m_diskCachePath, &expires);
+        if (!image.isNull()) {
+            if (expires > 0 && expires < QDateTime::currentMSecsSinceEpoch()) {
+                //unmapped before being removed
+                image = QImage();
+                QFile::remove(m_diskCachePath);
+            } else {
+                IconDiskCache::markUsed(m_diskCachePath);
+            }
+        }
+        emit m_loader->probed(m_key.url, m_key.size, image);
+    }
+
+private:
+    RemoteImageLoader *m_loader;
+    RemoteImageKey m_key;
+    QString m_diskCachePath;
+};
+
+class DiskPruneJob : public QRunnable
+{
+public:
+    explicit DiskPruneJob(const QString &directory)
+        : m_directory(directory)
+    {}
+
+    void run() Q_DECL_OVERRIDE
+    {
+        //one at a time, a second one would find nothing to do anyway
+        static QAtomicInt running;
+        if (running.testAndSetAcquire(0, 1)) {
+            IconDiskCache::prune(m_directory, s_diskCacheMaxBytes);
+            running.storeRelease(0);
+        }
+    }
+
+private:
+    QString m_directory;
+};
+
+Q_GLOBAL_STATIC(RemoteImageLoader, s_remoteImageLoader)
+
+RemoteImageLoader::RemoteImageLoader()
+    : QObject()
+{
+    //costs are in KiB
+    m_images.setMaxCost(32 * 1024);
+    m_encodedData.setMaxCost(8 * 1024);
+
+    connect(this, &RemoteImageLoader::decoded,
+            this, &RemoteImageLoader::deliver, Qt::QueuedConnection);
+    connect(this, &RemoteImageLoader::probed,
+            this, &RemoteImageLoader::handleProbed, Qt::QueuedConnection);
+}
+
+RemoteImageLoader::~RemoteImageLoader()
+{
+}
+
+RemoteImageLoader *RemoteImageLoader::self()
+{
+    return s_remoteImageLoader;
+}
+
+QImage RemoteImageLoader::cachedImage(const QUrl &url, const QSize &size)
+{
+    QImage *image = m_images.object({url, size});
+    return image ? *image : QImage();
+}
+
+void RemoteImageLoader::load(QNetworkAccessManager *qnam, const QUrl &url, const QSize &size, QObject *context, const Callback &callback)
+{
+    const RemoteImageKey key = {url, size};
+    const Waiter waiter = {context, callback};
+
+    auto it = m_pendingImages.find(key);
+    if (it != m_pendingImages.end()) {
+        it->waiters.append(waiter);
+        return;
+    }
+
+    PendingImage &pending = m_pendingImages[key];
+    pending.qnam = qnam;
+    pending.waiters.append(waiter);
+
+    //already downloaded for another size
+    if (EncodedImage *encoded = encodedImage(url)) {
+        decode(key, encoded->data, encoded->expires);
+        return;
+    }
+
+    const QString diskCachePath = IconDiskCache::self()->remoteFilePath(url, size);
+    if (!diskCachePath.isEmpty()) {
+        IconRasterizer::self()->threadPool()->start(new DiskProbeJob(this, key, diskCachePath));
+    } else {
+        fetch(key);
+    }
+}
+
+QImage RemoteImageLoader::decodeImage(const QByteArray &data, const QSize &size)
+{
+    QBuffer buffer;
+    buffer.setData(data);
+    buffer.open(QIODevice::ReadOnly);
+
+    QImageReader reader(&buffer);
+    const QSize originalSize = reader.size();
+    if (originalSize.isValid() && size.isValid()) {
+        //never upscale here, that's up to the final rasterization
+        const QSize scaledSize = originalSize.scaled(size, Qt::KeepAspectRatioByExpanding);
+        if (scaledSize.width() < originalSize.width()) {
+            reader.setScaledSize(scaledSize);
+        }
+    }
+
+    return reader.read();
+}
+
+void RemoteImageLoader::handleProbed(const QUrl &url, const QSize &size, const QImage &image)
+{
+    if (!image.isNull()) {
+        deliver(url, size, image);
+    } else if (EncodedImage *encoded = encodedImage(url)) {
+        //downloaded for another size while looking on disk
+        decode({url, size}, encoded->data, encoded->expires);
+    } else {
+        fetch({url, size});
+    }
+}
+
+void RemoteImageLoader::fetch(const RemoteImageKey &key)
+{
+    auto it = m_downloads.find(key.url);
+    if (it != m_downloads.end()) {
+        if (!it->sizes.contains(key.size)) {
+            it->sizes.append(key.size);
+        }
+        return;
+    }
+
+    Download &download = m_downloads[key.url];
+    download.qnam = m_pendingImages.value(key).qnam;
+    download.sizes.append(key.size);
+    get(key.url, key.url);
+}
+
+RemoteImageLoader::EncodedImage *RemoteImageLoader::encodedImage(const QUrl &url)
+{
+    EncodedImage *encoded = m_encodedData.object(url);
+    if (encoded && encoded->expires > 0 && encoded->expires < QDateTime::currentMSecsSinceEpoch()) {
+        m_encodedData.remove(url);
+        return Q_NULLPTR;
+    }
+    return encoded;
+}
+
+qint64 RemoteImageLoader::expiryOf(QNetworkReply *reply)
+{
+    const QByteArray cacheControl = reply->rawHeader("Cache-Control").toLower();
+    if (cacheControl.contains("no-store") || cacheControl.contains("no-cache")) {
+        return -1;
+    }
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    qint64 lifetime = -1;
+    for (const QByteArray &directive : cacheControl.split(',')) {
+        const QByteArray trimmed = directive.trimmed();
+        bool ok = false;
+        const qint64 seconds = trimmed.startsWith("max-age=") ? trimmed.mid(8).toLongLong(&ok) : 0;
+        if (ok) {
+            lifetime = seconds * 1000;
+        }
+    }
+    if (lifetime < 0 && reply->hasRawHeader("Expires")) {
+        //an invalid date, such as "0", means already expired
+        const QDateTime expires = QDateTime::fromString(QString::fromLatin1(reply->rawHeader("Expires")), Qt::RFC2822Date);
+        lifetime = expires.isValid() ? expires.toMSecsSinceEpoch() - now : 0;
+    }
+    if (lifetime < 0) {
+        //the usual heuristic: a tenth of the time since the last change, or a day without validators
+        const QDateTime lastModified = reply->header(QNetworkRequest::LastModifiedHeader).toDateTime();
+        lifetime = lastModified.isValid() ? (now - lastModified.toMSecsSinceEpoch()) / 10 : 24 * 3600 * 1000;
+    }
+
+    if (lifetime <= 0) {
+        return -1;
+    }
+    return now + qMin(lifetime, qint64(s_diskCacheMaxAgeDays) * 24 * 3600 * 1000);
+}
+
+void RemoteImageLoader::decode(const RemoteImageKey &key, const QByteArray &data, qint64 expires)
+{
+    const QString diskCachePath = expires >= 0 ? IconDiskCache::self()->remoteFilePath(key.url, key.size) : QString();
+    IconRasterizer::self()->threadPool()->start(new ImageDecodeJob(this, key, data, diskCachePath, expires));
+
+    if (!diskCachePath.isEmpty() && m_diskWrites++ % s_diskWritesPerPrune == 0) {
+        IconRasterizer::self()->threadPool()->start(new DiskPruneJob(QFileInfo(diskCachePath).absolutePath()));
+    }
+}
+
+void RemoteImageLoader::get(const QUrl &url, const QUrl &target)
+{
+    Download &download = m_downloads[url];
+    if (!download.qnam) {
+        handleFinished(url, nullptr);
+        return;
+    }
+
+    QNetworkRequest request(target);
+    request.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::PreferCache);
+    QNetworkReply *reply = download.qnam->get(request);
+
+    //just accumulate what arrives, decoding happens once everything is there
+    connect(reply, &QNetworkReply::readyRead, this, [this, url, reply]() {
+        auto it = m_downloads.find(url);
+        if (it != m_downloads.end() && reply->attribute(QNetworkRequest::RedirectionTargetAttribute).isNull()) {
+            it->data.append(reply->readAll());
+        }
+    });
+    connect(reply, &QNetworkReply::finished, this, [this, url, reply]() {
+        handleFinished(url, reply);
+    });
+}
+
+void RemoteImageLoader::handleFinished(const QUrl &url, QNetworkReply *reply)
+{
+    if (reply) {
+        reply->deleteLater();
+
+        if (reply->error() == QNetworkReply::NoError) {
+            const QUrl possibleRedirectUrl = reply->attribute(QNetworkRequest::RedirectionTargetAttribute).toUrl();
+            if (!possibleRedirectUrl.isEmpty()) {
+                const QUrl redirectUrl = reply->url().resolved(possibleRedirectUrl);
+                Download &download = m_downloads[url];
+                // no infinite redirections thank you very much
+                if (redirectUrl != reply->url() && ++download.redirects <= s_maxRedirects) {
+                    download.data.clear();
+                    get(url, redirectUrl);
+                    return;
+                }
+            } else {
+                Download download = m_downloads.take(url);
+                download.data.append(reply->readAll());
+                const qint64 expires = expiryOf(reply);
+                m_encodedData.insert(url, new EncodedImage{download.data, expires}, qMax(1, download.data.size() / 1024));
+                for (const QSize &size : download.sizes) {
+                    decode({url, size}, download.data, expires);
+                }
+                return;
+            }
+        }
+    }
+
+    //failed
+    const Download download = m_downloads.take(url);
+    for (const QSize &size : download.sizes) {
+        deliver(url, size, QImage());
+    }
+}
+
+void RemoteImageLoader::deliver(const QUrl &url, const QSize &size, const QImage &image)
+{
+    const RemoteImageKey key = {url, size};
+    if (!image.isNull()) {
+        m_images.insert(key, new QImage(image), qMax(1, image.byteCount() / 1024));
+    }
+
+    const PendingImage pending = m_pendingImages.take(key);
+    for (const Waiter &waiter : pending.waiters) {
+        if (waiter.context && waiter.callback) {
+            waiter.callback(image);
+        }
+    }
+}
+
+#include "moc_remoteimageloader.cpp"
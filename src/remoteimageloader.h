@@ -0,0 +1,143 @@
+/*
+ *   Copyright 2017 Marco Martin <mart@kde.org>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Library General Public License as
+ *   published by the Free Software Foundation; either version 2, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details
+ *
+ *   You should have received a copy of the GNU Library General Public
+ *   License along with this program; if not, write to the
+ *   Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef REMOTEIMAGELOADER_H
+#define REMOTEIMAGELOADER_H
+
+#include <QObject>
+#include <QCache>
+#include <QHash>
+#include <QImage>
+#include <QPointer>
+#include <QUrl>
+#include <QVector>
+
+#include <functional>
+
+class QNetworkAccessManager;
+class QNetworkReply;
+
+/**
+ * Identifies a remote image decoded at a given size.
+ */
+struct RemoteImageKey
+{
+    QUrl url;
+    QSize size;
+};
+
+inline bool operator==(const RemoteImageKey &k1, const RemoteImageKey &k2)
+{
+    return k1.url == k2.url && k1.size == k2.size;
+}
+
+inline uint qHash(const RemoteImageKey &key, uint seed = 0)
+{
+    return qHash(key.url, seed) ^ qHash(key.size.width() << 16 | key.size.height(), seed);
+}
+
+/**
+ * Downloads images over http(s) for DesktopIcon without ever blocking
+ * the GUI thread: the data is accumulated as it arrives and decoded in
+ * the icon thread pool, directly at the size it's needed at.
+ *
+ * Everything is shared process wide: any number of icons asking for the
+ * same url at the same time share a single download and decoding, and
+ * recently used images are kept in a size bounded cache, both as encoded
+ * data and decoded at the sizes they were requested.
+ * If the icon disk cache is enabled, decoded images are stored on disk too,
+ * for as long as the http caching headers of the response allow, in a
+ * directory bounded in size where the least recently used images go first.
+ */
+class RemoteImageLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+    typedef std::function<void(const QImage &)> Callback;
+
+    RemoteImageLoader();
+    ~RemoteImageLoader();
+
+    static RemoteImageLoader *self();
+
+    /**
+     * @returns the image at @p url decoded for @p size if it's already in the
+     * memory cache, a null image otherwise.
+     */
+    QImage cachedImage(const QUrl &url, const QSize &size);
+
+    /**
+     * Downloads and decodes the image at @p url, for it to be displayed at @p size.
+     * @p callback is invoked in the GUI thread with the decoded image, or a null
+     * image if it couldn't be loaded, unless @p context got deleted in the meantime.
+     */
+    void load(QNetworkAccessManager *qnam, const QUrl &url, const QSize &size, QObject *context, const Callback &callback);
+
+    /**
+     * Decodes @p data, scaled down to cover @p size if it's bigger.
+     * Safe to call from any thread.
+     */
+    static QImage decodeImage(const QByteArray &data, const QSize &size);
+
+Q_SIGNALS:
+    // emitted from the worker threads, internal use only
+    void decoded(const QUrl &url, const QSize &size, const QImage &image);
+    void probed(const QUrl &url, const QSize &size, const QImage &image);
+
+private Q_SLOTS:
+    void deliver(const QUrl &url, const QSize &size, const QImage &image);
+    void handleProbed(const QUrl &url, const QSize &size, const QImage &image);
+
+private:
+    struct Waiter {
+        QPointer<QObject> context;
+        Callback callback;
+    };
+    struct PendingImage {
+        QPointer<QNetworkAccessManager> qnam;
+        QVector<Waiter> waiters;
+    };
+    struct Download {
+        QPointer<QNetworkAccessManager> qnam;
+        QByteArray data;
+        QVector<QSize> sizes;
+        int redirects = 0;
+    };
+    struct EncodedImage {
+        QByteArray data;
+        //in msecs since the epoch, 0 for never, -1 if it must not be stored on disk
+        qint64 expires;
+    };
+
+    static qint64 expiryOf(QNetworkReply *reply);
+    EncodedImage *encodedImage(const QUrl &url);
+    void fetch(const RemoteImageKey &key);
+    void decode(const RemoteImageKey &key, const QByteArray &data, qint64 expires);
+    void get(const QUrl &url, const QUrl &target);
+    void handleFinished(const QUrl &url, QNetworkReply *reply);
+
+    QHash<RemoteImageKey, PendingImage> m_pendingImages;
+    QHash<QUrl, Download> m_downloads;
+    QCache<RemoteImageKey, QImage> m_images;
+    QCache<QUrl, EncodedImage> m_encodedData;
+    int m_diskWrites = 0;
+};
+
+#endif